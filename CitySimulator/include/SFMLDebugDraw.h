@@ -18,26 +18,54 @@
 #define SFMLDEBUGDRAW_H
 
 #include <Box2D/Box2D.h>
-#include <SFML/Window.hpp>
+#include <SFML/Graphics.hpp>
+#include <vector>
 #include "constants.hpp"
 
-namespace sf
-{
-	class RenderWindow;
-}
-
 namespace sfdd
 {
 	const float SCALE = Constants::tileSizef;
 }
 
+/// Collects every primitive into a line and a triangle buffer, which are drawn together by Flush
 class SFMLDebugDraw : public b2Draw
 {
 private:
-	sf::RenderWindow *m_window;
+	sf::RenderTarget *m_target;
+	sf::VertexArray m_lines;
+	sf::VertexArray m_triangles;
+	std::vector<b2Fixture *> m_visible;
+
+	/// Gathers the fixtures whose AABBs overlap the query
+	struct VisibleFixtures : public b2QueryCallback
+	{
+		std::vector<b2Fixture *> &fixtures;
+
+		explicit VisibleFixtures(std::vector<b2Fixture *> &fixtures) : fixtures(fixtures)
+		{
+		}
+
+		bool ReportFixture(b2Fixture *fixture) override
+		{
+			fixtures.push_back(fixture);
+			return true;
+		}
+	};
+
+	void AddLine(const b2Vec2 &p1, const b2Vec2 &p2, const sf::Color &color);
+
+	void AddCircle(const b2Vec2 &center, float32 radius, const sf::Color &outline, const sf::Color *fill);
+
+	void DrawFixture(b2Fixture *fixture);
 
 public:
-	SFMLDebugDraw(sf::RenderWindow &window);
+	SFMLDebugDraw(sf::RenderTarget &target);
+
+	/// Draws the shapes of the fixtures in the target's view, found with an AABB query, in two draw calls
+	void DrawVisible(const b2World &world);
+
+	/// Draws and clears the buffered primitives
+	void Flush();
 
 	/// Convert Box2D's OpenGL style color definition[0-1] to SFML's color definition[0-255], with optional alpha byte[Default - opaque]
 	static sf::Color GLColorToSFML(const b2Color &color, sf::Uint8 alpha = 255)
@@ -3,6 +3,7 @@
 
 #include "input.hpp"
 #include "ecs.hpp"
+#include "behaviour.hpp"
 #include "service/input_service.hpp"
 
 struct PhysicsComponent;
@@ -118,6 +119,36 @@ public:
 
 	void tick(float delta);
 
+	/**
+	 * @return If this brain has finished its current action, and should decide what to do next
+	 */
+	virtual bool wantsToThink() const
+	{
+		return false;
+	}
+
+	/**
+	 * Decides on the next action, which will be carried out on every tick until finished
+	 */
+	virtual void think()
+	{
+	}
+
+	/**
+	 * @return If this brain has nothing interesting to do, and so can be ticked less often
+	 */
+	virtual bool isIdle() const
+	{
+		return false;
+	}
+
+	/**
+	 * @return If this brain should always be ticked every frame, regardless of where it is
+	 */
+	virtual bool isImportant() const
+	{
+		return false;
+	}
 
 protected:
 	EntityID entity;
@@ -144,12 +175,20 @@ protected:
 // brains
 
 /**
- * A brain with behaviours
+ * A brain with behaviours, which are shared between all brains using the same tree
  */
 class EntityBrain : public Brain
 {
 public:
-	EntityBrain(EntityID e);
+	EntityBrain(EntityID e, const BehaviourTree *behaviour);
+
+	virtual ~EntityBrain();
+
+	bool wantsToThink() const override;
+
+	void think() override;
+
+	bool isIdle() const override;
 
 protected:
 	virtual void initController(float movementForce, float maxWalkSpeed, float maxSprintSpeed);
@@ -164,6 +203,12 @@ protected:
 
 private:
 	boost::shared_ptr<DynamicMovementController> controller;
+
+	const BehaviourTree *behaviour;
+	Blackboard blackboard;
+	ArriveSteering steering;
+
+	void startAction(const BehaviourNode &action);
 };
 
 /**
@@ -176,6 +221,11 @@ public:
 
 	virtual ~InputBrain();
 
+	bool isImportant() const override
+	{
+		return true;
+	}
+
 protected:
 	virtual void initController(float movementForce, float maxWalkSpeed, float maxSprintSpeed);
 
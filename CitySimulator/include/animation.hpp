@@ -6,9 +6,30 @@
 #include "constants.hpp"
 #include "utils.hpp"
 
+class SpriteBatch;
+
+/**
+ * Every frame of every sequence in one flat table, so that animators only need to hold indices into it
+ */
 struct Animation
 {
-	typedef std::vector<sf::IntRect> Sequence;
+	/**
+	 * A frame's quad at the origin, ready to be drawn
+	 */
+	struct Frame
+	{
+		sf::IntRect rect;
+		sf::Vertex quad[4];
+	};
+
+	/**
+	 * A run of consecutive frames in the table
+	 */
+	struct Sequence
+	{
+		unsigned first;
+		unsigned length;
+	};
 
 	explicit Animation(sf::Texture *animationTexture) : texture(animationTexture)
 	{
@@ -16,13 +37,15 @@ struct Animation
 
 	Animation *addRow(const sf::Vector2i &startPosition, const sf::Vector2i &spriteDimensions, int rowLength);
 
+	Animation *addSequence(const std::vector<sf::IntRect> &rects);
 
-	//	std::vector<Sequence>& getSequences()
-	//	{
-	//		return sequences;
-	//	}
+	inline const Frame &getFrame(unsigned sequence, unsigned frame) const
+	{
+		return frames[sequences[sequence].first + frame];
+	}
 
 	sf::Texture *texture;
+	std::vector<Frame> frames;
 	std::vector<Sequence> sequences;
 };
 
@@ -42,6 +65,17 @@ public:
 
 	void tick(float delta);
 
+	/**
+	 * Sets the current frame from a shared clock instead of ticking, continuing from the frame it was on when it
+	 * last started playing
+	 */
+	void evaluate(float clock);
+
+	unsigned getCurrentFrame() const
+	{
+		return currentFrame;
+	}
+
 	/// <summary>
 	/// Turns in the given direction.
 	/// </summary>
@@ -64,25 +98,27 @@ public:
 
 	void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
 
+	/**
+	 * Adds the current frame to the given batch instead of drawing it straight away
+	 */
+	void draw(SpriteBatch &batch, sf::RenderStates states) const;
+
 
 private:
-	Animation *animation;
+	const Animation *animation;
 
 	Utils::TimeTicker ticker;
 
-	size_t currentSequence;
-	size_t currentFrame;
+	unsigned currentSequence;
+	unsigned currentFrame;
 	bool playing;
 
-	sf::VertexArray vertices;
-	sf::Vector2f currentSize;
+	// clock driven
+	float step;
+	float phase;
+	bool restartPhase;
 
 	DirectionType direction;
-
-
-	void resizeVertices(float width, float height);
-
-	void updateFrame();
 };
 
 #endif
\ No newline at end of file
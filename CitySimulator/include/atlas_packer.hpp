@@ -0,0 +1,63 @@
+#ifndef CITYSIMULATOR_ATLAS_PACKER_HPP
+#define CITYSIMULATOR_ATLAS_PACKER_HPP
+
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+
+/**
+ * Packs rectangles into as few power-of-two pages as possible with the MaxRects algorithm, using the best short side
+ * fit heuristic. Each page is the smallest power-of-two size that fits its rectangles, and rectangles that don't fit
+ * in a page of the maximum size spill into further pages
+ */
+class AtlasPacker
+{
+public:
+	struct Placement
+	{
+		unsigned page;
+		sf::IntRect rect;
+	};
+
+	explicit AtlasPacker(unsigned maxPageSize);
+
+	/**
+	 * Packs rectangles of the given sizes, replacing any previous packing
+	 * @return False if a rectangle is larger than the maximum page size
+	 */
+	bool pack(const std::vector<sf::Vector2u> &sizes);
+
+	/**
+	 * @return Where each rectangle was placed, in the order they were given
+	 */
+	const std::vector<Placement> &getPlacements() const
+	{
+		return placements;
+	}
+
+	const std::vector<sf::Vector2u> &getPageSizes() const
+	{
+		return pageSizes;
+	}
+
+	/**
+	 * @return The fraction of the total page area covered by rectangles
+	 */
+	float getEfficiency() const;
+
+private:
+	unsigned maxPageSize;
+
+	std::vector<sf::Vector2u> sizes;
+	std::vector<Placement> placements;
+	std::vector<sf::Vector2u> pageSizes;
+
+	/**
+	 * Places as many of the given rectangles in a page of the given size as possible, in order
+	 * @param placed The index and position of each rectangle that fit
+	 * @param leftover The rectangles that didn't fit
+	 */
+	void packPage(const sf::Vector2u &pageSize, const std::vector<size_t> &indices,
+				  std::vector<std::pair<size_t, sf::IntRect>> &placed, std::vector<size_t> &leftover) const;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef CITYSIMULATOR_AVOIDANCE_HPP
+#define CITYSIMULATOR_AVOIDANCE_HPP
+
+#include <vector>
+#include "ecs.hpp"
+#include "spatial.hpp"
+#include "workers.hpp"
+
+/**
+ * The state of a single agent as seen by local avoidance, in tile units
+ */
+struct AvoidanceAgent
+{
+	b2Vec2 position;
+	b2Vec2 velocity;
+	b2Vec2 preferredVelocity;
+	float radius;
+	float maxSpeed;
+
+	// if false, others take full responsibility for avoiding this agent
+	bool responsive;
+};
+
+// optimal reciprocal collision avoidance (ORCA)
+namespace Avoidance
+{
+	/**
+	 * A half-plane of permitted velocities, lying to the left of the directed line
+	 */
+	struct Line
+	{
+		b2Vec2 point;
+		b2Vec2 direction;
+	};
+
+	/**
+	 * Reusable per-thread buffers, to avoid allocating for every agent
+	 */
+	struct Scratch
+	{
+		std::vector<Line> lines;
+		std::vector<Line> projectedLines;
+		std::vector<std::pair<float, const AvoidanceAgent *>> neighbours;
+	};
+
+	/**
+	 * Finds the velocity closest to the agent's preferred velocity that will not collide with any of the given
+	 * neighbours within the time horizon, assuming they each take half the responsibility for avoiding the agent
+	 * @param timeHorizon How far ahead (in seconds) to look for collisions
+	 * @param delta The length of this step, used to resolve agents that are already overlapping
+	 */
+	b2Vec2 computeVelocity(const AvoidanceAgent &agent, const std::vector<const AvoidanceAgent *> &neighbours,
+						   float timeHorizon, float delta, Scratch &scratch);
+}
+
+/**
+ * Adjusts the desired steering of every agent with a brain so that they steer around each other, and writes the
+ * result to the steering applied by the physics system. Agents are solved in parallel, with neighbours found through
+ * the entity service's spatial grid
+ */
+class AvoidanceSystem : public System
+{
+public:
+	AvoidanceSystem();
+
+	void tick(EntityService *es, float dt) override;
+
+	void tickEntity(EntityService *es, EntityID e, float dt) override;
+
+private:
+	bool enabled;
+	float radius;
+	float neighbourDistance;
+	size_t maxNeighbours;
+	float timeHorizon;
+
+	EntityID playerEntity;
+
+	WorkerPool workers;
+
+	std::vector<EntityID> entities;
+	std::vector<AvoidanceAgent> agents;
+	std::vector<b2Vec2> newVelocities;
+	std::vector<EntityID> entityToAgent;
+
+	void avoid(EntityService *es, float dt);
+
+	void solveRange(const SpatialGrid &grid, size_t begin, size_t end, float dt);
+};
+
+#endif
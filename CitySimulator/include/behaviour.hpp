@@ -0,0 +1,131 @@
+#ifndef CITYSIMULATOR_BEHAVIOUR_HPP
+#define CITYSIMULATOR_BEHAVIOUR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+#include <SFML/System/Vector2.hpp>
+
+typedef uint16_t BehaviourNodeIndex;
+
+const BehaviourNodeIndex INVALID_BEHAVIOUR_NODE = UINT16_MAX;
+
+/**
+ * The most composites that can be nested inside each other
+ */
+const unsigned MAX_BEHAVIOUR_DEPTH = 8;
+
+enum BehaviourNodeType
+{
+	// composites
+	BEHAVIOUR_SEQUENCE,
+	BEHAVIOUR_SELECTOR,
+
+	// conditions
+	BEHAVIOUR_CHANCE,
+	BEHAVIOUR_TIME_BETWEEN,
+
+	// actions
+	BEHAVIOUR_WANDER,
+	BEHAVIOUR_WAIT,
+	BEHAVIOUR_SLEEP_UNTIL,
+
+	BEHAVIOUR_UNKNOWN
+};
+
+enum BehaviourStatus
+{
+	STATUS_RUNNING,
+	STATUS_SUCCESS,
+	STATUS_FAILURE
+};
+
+namespace Behaviour
+{
+	BehaviourNodeType parseType(const std::string &s);
+
+	bool isAction(BehaviourNodeType type);
+}
+
+/**
+ * A single node of a flattened tree. A node's children directly follow it, and its subtree ends at end
+ */
+struct BehaviourNode
+{
+	BehaviourNodeType type;
+	BehaviourNodeIndex end;
+
+	// meaning depends on the type, eg. wander radius and timeout
+	float params[2];
+};
+
+/**
+ * The state of a single agent running a behaviour tree, as the tree itself is shared between all agents using it
+ */
+struct Blackboard
+{
+	Blackboard() : action(INVALID_BEHAVIOUR_NODE), status(STATUS_SUCCESS), timer(0.f)
+	{
+		std::fill(running, running + MAX_BEHAVIOUR_DEPTH, INVALID_BEHAVIOUR_NODE);
+	}
+
+	BehaviourNodeIndex action;
+	BehaviourStatus status;
+
+	// used by the current action
+	float timer;
+	sf::Vector2f target;
+
+	// the child each composite on the path to the running action is resuming from, by composite depth
+	BehaviourNodeIndex running[MAX_BEHAVIOUR_DEPTH];
+};
+
+/**
+ * A tree of behaviours loaded from data, stored depth-first in a flat array
+ */
+class BehaviourTree
+{
+public:
+	/**
+	 * Flattens the given node and its children, replacing any previous tree
+	 */
+	void load(const boost::property_tree::ptree &root);
+
+	/**
+	 * Evaluates the tree from the root, consuming the result of the finished action on the blackboard
+	 * @return The action that should now be started, or INVALID_BEHAVIOUR_NODE if none was chosen
+	 */
+	BehaviourNodeIndex think(Blackboard &blackboard) const;
+
+	const BehaviourNode &getNode(BehaviourNodeIndex index) const;
+
+	size_t getNodeCount() const
+	{
+		return nodes.size();
+	}
+
+private:
+	std::vector<BehaviourNode> nodes;
+
+	void flatten(const boost::property_tree::ptree &node, unsigned depth);
+
+	/**
+	 * @param depth The number of composites above this node
+	 */
+	BehaviourStatus evaluate(BehaviourNodeIndex index, unsigned depth, Blackboard &blackboard,
+							 BehaviourNodeIndex &chosen) const;
+};
+
+typedef std::map<std::string, BehaviourTree> BehaviourTrees;
+
+namespace Behaviour
+{
+	/**
+	 * Loads all named trees from the given JSON file
+	 */
+	void loadTrees(const std::string &path, BehaviourTrees &out);
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <SFML/Graphics/Rect.hpp>
 #include <map>
+#include <vector>
 
 class World;
 
@@ -26,7 +27,8 @@ class Building
 {
 public:
 	Building(World &world, const sf::IntRect &tileBounds, int id, std::string buildingWorldName)
-			: outsideWorld(&world), buildingID(id), insideWorldName(buildingWorldName), bounds(tileBounds)
+			: outsideWorld(&world), insideWorld(nullptr), buildingID(id), insideWorldName(buildingWorldName),
+			  bounds(tileBounds)
 	{
 	}
 
@@ -46,10 +48,19 @@ public:
 
 	Door *getDoorByTile(const sf::Vector2i &tile);
 
+	/**
+	 * Appends all doors, both inside and outside
+	 */
+	void getDoors(std::vector<Door *> &out);
+
 	int getID() const;
 
 	std::string getInsideWorldName() const;
 
+	World *getInsideWorld() const;
+
+	void setInsideWorld(World *world);
+
 	Door *getConnectedDoor(Door *door);
 
 private:
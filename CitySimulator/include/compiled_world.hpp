@@ -0,0 +1,211 @@
+#ifndef CITYSIMULATOR_COMPILED_WORLD_HPP
+#define CITYSIMULATOR_COMPILED_WORLD_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/interprocess/mapped_region.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include "maploader.hpp"
+
+/**
+ * Everything derived from a world's map when it is loaded, laid out as flat arrays so that a compiled file can be
+ * memory mapped and used without any parsing. Maps are compiled in memory when there is no up to date file, so the
+ * world is always loaded from one of these
+ */
+class CompiledWorld
+{
+public:
+	enum Section
+	{
+		SECTION_LAYERS,
+		SECTION_FLIPPED_GIDS,
+		SECTION_TILES,
+		SECTION_OBJECTS,
+		SECTION_BUILDINGS,
+		SECTION_DOORS,
+		SECTION_COLLISIONS,
+		SECTION_STRINGS,
+
+		SECTION_COUNT
+	};
+
+	/**
+	 * A visible layer, in depth order
+	 */
+	struct Layer
+	{
+		int32_t type;
+		int32_t depth;
+	};
+
+	struct Object
+	{
+		int32_t blockType;
+		int32_t flipGID;
+		float rotation;
+		sf::Vector2f position;
+	};
+
+	struct Building
+	{
+		int32_t id;
+		sf::IntRect bounds;
+
+		// the inside world's name in the string section
+		uint32_t worldName;
+		uint32_t worldNameLength;
+	};
+
+	struct Door
+	{
+		int32_t buildingID;
+		int32_t doorID;
+		sf::Vector2i tile;
+	};
+
+	/**
+	 * A static collision box, already merged with its neighbours
+	 */
+	struct CollisionRect
+	{
+		sf::FloatRect rect;
+		float rotation;
+		int32_t blockType;
+	};
+
+	template<class T>
+	struct Array
+	{
+		const T *data;
+		size_t count;
+
+		const T *begin() const
+		{
+			return data;
+		}
+
+		const T *end() const
+		{
+			return data + count;
+		}
+
+		size_t size() const
+		{
+			return count;
+		}
+
+		const T &operator[](size_t index) const
+		{
+			return data[index];
+		}
+	};
+
+	CompiledWorld();
+
+	/**
+	 * Derives everything from the given map into memory
+	 */
+	void compile(const TMX::TileMap &tileMap);
+
+	/**
+	 * Writes the compiled world to the given file
+	 */
+	bool save(const std::string &path) const;
+
+	/**
+	 * Memory maps the given compiled file
+	 * @return False if the file can't be mapped, is from another version or is corrupt
+	 */
+	bool open(const std::string &path);
+
+	sf::Vector2i getTileSize() const;
+
+	/**
+	 * @return The raw gids of every tile layer in turn, in the order they appear in the layer section
+	 */
+	Array<TMX::rot> getTiles() const
+	{
+		return getSection<TMX::rot>(SECTION_TILES);
+	}
+
+	Array<Layer> getLayers() const
+	{
+		return getSection<Layer>(SECTION_LAYERS);
+	}
+
+	Array<int32_t> getFlippedGIDs() const
+	{
+		return getSection<int32_t>(SECTION_FLIPPED_GIDS);
+	}
+
+	Array<Object> getObjects() const
+	{
+		return getSection<Object>(SECTION_OBJECTS);
+	}
+
+	Array<Building> getBuildings() const
+	{
+		return getSection<Building>(SECTION_BUILDINGS);
+	}
+
+	Array<Door> getDoors() const
+	{
+		return getSection<Door>(SECTION_DOORS);
+	}
+
+	Array<CollisionRect> getCollisionRects() const
+	{
+		return getSection<CollisionRect>(SECTION_COLLISIONS);
+	}
+
+	std::string getString(uint32_t offset, uint32_t length) const;
+
+	/**
+	 * @return True if loaded from a compiled file rather than compiled in memory
+	 */
+	bool isMapped() const
+	{
+		return region.get_address() != nullptr;
+	}
+
+private:
+	struct SectionHeader
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t size;
+		sf::Vector2i tileSize;
+		SectionHeader sections[SECTION_COUNT];
+	};
+
+	std::vector<char> buffer;
+	boost::interprocess::mapped_region region;
+	const char *data;
+	size_t size;
+
+	const Header &getHeader() const
+	{
+		return *reinterpret_cast<const Header *>(data);
+	}
+
+	template<class T>
+	Array<T> getSection(Section section) const
+	{
+		const SectionHeader &header = getHeader().sections[section];
+		return {reinterpret_cast<const T *>(data + header.offset), header.count};
+	}
+
+	/**
+	 * @return False if the header doesn't match this version, or a section is outside of the data
+	 */
+	bool validate() const;
+};
+
+#endif
@@ -13,6 +13,7 @@ typedef int EntityID;
 #include "animation.hpp"
 #include "config.hpp"
 #include "constants.hpp"
+#include "sprite_batch.hpp"
 
 class b2World;
 
@@ -108,7 +109,7 @@ struct PhysicsComponent : BaseComponent
 
 	inline bool isSteering()
 	{
-		return steering.x != 0.f || steering.y != 0.f;
+		return desiredSteering.x != 0.f || desiredSteering.y != 0.f;
 	}
 
 	float maxSpeed;
@@ -118,11 +119,21 @@ struct PhysicsComponent : BaseComponent
 	b2World *bWorld;
 	b2Vec2 lastVelocity;
 
+	/**
+	 * Where the brain wants to go, only written by the brain
+	 */
+	b2Vec2 desiredSteering;
+
+	/**
+	 * The steering applied by the physics system, after avoidance
+	 */
 	b2Vec2 steering;
 };
 
 class EntityService;
 
+class ClockService;
+
 // systems
 class System
 {
@@ -135,13 +146,13 @@ public:
 	{
 	}
 
-	void tick(EntityService *es, float dt);
+	virtual void tick(EntityService *es, float dt);
 
-	void render(EntityService *es, sf::RenderWindow &window);
+	virtual void render(EntityService *es, sf::RenderTarget &target);
 
 	virtual void tickEntity(EntityService *es, EntityID e, float dt) = 0;
 
-	virtual void renderEntity(EntityService *es, EntityID e, sf::RenderWindow &window)
+	virtual void renderEntity(EntityService *es, EntityID e, sf::RenderTarget &target)
 	{
 	}
 
@@ -149,26 +160,99 @@ protected:
 	int mask;
 };
 
+/**
+ * Draws every entity's sprite in a single batch, with those further south in front. Only entities near the view are
+ * animated and drawn. Animations are either ticked, or evaluated from a shared clock as they are drawn
+ */
 class RenderSystem : public System
 {
 public:
-	RenderSystem() : System(COMPONENT_PHYSICS | COMPONENT_RENDER)
+	RenderSystem();
+
+	void tick(EntityService *es, float dt) override;
+
+	void tickEntity(EntityService *es, EntityID e, float dt) override;
+
+	void render(EntityService *es, sf::RenderTarget &target) override;
+
+	void renderEntity(EntityService *es, EntityID e, sf::RenderTarget &target) override;
+
+	/**
+	 * Starts the entity's animation from now, so it doesn't catch up on time from before it was added
+	 */
+	void resetTicked(EntityID e)
 	{
+		lastTicked[e] = time;
 	}
 
-	void tickEntity(EntityService *es, EntityID e, float dt) override;
+private:
+	SpriteBatch batch;
+
+	bool clockDriven;
+
+	// culling
+	float cullMargin;
+	float time;
+	std::vector<float> lastTicked;
+	std::vector<EntityID> visible;
+
+	/**
+	 * Finds the entities within the cull margin of the given view, in order, or every entity if there is no view
+	 */
+	void findVisible(EntityService *es, const sf::View *view, std::vector<EntityID> &out);
 
-	void renderEntity(EntityService *es, EntityID e, sf::RenderWindow &window) override;
+	/**
+	 * Plays and turns the entity's animation to match its movement
+	 */
+	Animator &updateAnimation(EntityService *es, EntityID e);
 };
 
+/**
+ * Ticks brains at a rate depending on how far they are from the camera, then lets as many brains think as fit in the
+ * per-frame time budget
+ */
 class InputSystem : public System
 {
 public:
-	InputSystem() : System(COMPONENT_INPUT)
-	{
-	}
+	InputSystem();
+
+	void tick(EntityService *es, float dt) override;
 
 	void tickEntity(EntityService *es, EntityID e, float dt) override;
+
+private:
+	long thinkBudget;
+	unsigned thinkCursor;
+
+	// brains that aren't asleep, gathered each frame
+	std::vector<EntityID> awake;
+
+	// level of detail
+	bool lodEnabled;
+	float nearMargin;
+	float midMargin;
+	unsigned midInterval;
+	unsigned farInterval;
+	unsigned idleMultiplier;
+
+	unsigned frame;
+	std::vector<float> accumulatedDelta;
+
+	ClockService *clock;
+
+	b2World *cameraWorld;
+	sf::FloatRect nearArea;
+	sf::FloatRect midArea;
+
+	/**
+	 * @return The number of frames between each tick of the given brain
+	 */
+	unsigned getTickInterval(Brain *brain, PhysicsComponent *physics) const;
+
+	/**
+	 * Finds the brains to visit this frame, which are only those awake if there is a clock
+	 */
+	void findAwake(EntityService *es);
 };
 
 class PhysicsSystem : public System
@@ -178,6 +262,11 @@ public:
 	{
 	}
 
+	/**
+	 * Moves entities, and updates the entity service's spatial grid with their positions
+	 */
+	void tick(EntityService *es, float dt) override;
+
 	void tickEntity(EntityService *es, EntityID e, float dt) override;
 };
 
@@ -6,15 +6,13 @@
 #include "utils.hpp"
 #include "state/state.hpp"
 
-class b2World;
-
 class FPSCounter
 {
 public:
 
 	void init(float waitTime);
 
-	void tick(float delta, sf::RenderWindow &window);
+	void tick(float delta, sf::RenderTarget &target);
 
 private:
 
@@ -30,6 +28,11 @@ class BaseGame
 public:
 	BaseGame(sf::RenderWindow &window);
 
+	/**
+	 * Renders offscreen for a configured number of frames, with no window or input
+	 */
+	explicit BaseGame(sf::RenderTexture &texture);
+
 	virtual ~BaseGame()
 	{
 	}
@@ -47,7 +50,7 @@ protected:
 
 	virtual void tick(float delta) = 0;
 
-	virtual void render(sf::RenderWindow &window) = 0;
+	virtual void render(sf::RenderTarget &target) = 0;
 
 	void limitFrameRate(int limit, bool vsync);
 
@@ -58,8 +61,21 @@ protected:
 
 
 private:
+	void init();
+
 	void setWindowIcon(const std::string &path);
 
+	void runWindowed(sf::RenderWindow &window);
+
+	void runHeadless(sf::RenderTexture &texture);
+
+	/**
+	 * Clears the target and draws the current state, with the fps overlay on top
+	 */
+	void renderFrame(sf::RenderTarget &target, float delta);
+
+	void dumpFrame(const sf::RenderTexture &texture, const std::string &directory, int frame);
+
 	sf::Color backgroundColour;
 	FPSCounter fps;
 };
@@ -69,6 +85,8 @@ class Game : public BaseGame
 public:
 	Game(sf::RenderWindow &window);
 
+	explicit Game(sf::RenderTexture &texture);
+
 	~Game();
 
 protected:
@@ -78,13 +96,12 @@ protected:
 
 	void tick(float delta) override;
 
-	void render(sf::RenderWindow &window) override;
+	void render(sf::RenderTarget &target) override;
 
 public:
 	void switchState(StateType newScreenType);
 
 private:
-	b2World *box2DWorld;
 	State *current;
 	std::stack<State *> states;
 
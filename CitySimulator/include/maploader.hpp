@@ -1,7 +1,9 @@
 #ifndef CITYSIMULATOR_MAPLOADER_HPP
 #define CITYSIMULATOR_MAPLOADER_HPP
 
+#include <cstdint>
 #include <map>
+#include <string>
 #include <SFML/System/Vector2.hpp>
 #include <bitset>
 #include <vector>
@@ -35,12 +37,12 @@ namespace TMX
 			map.insert(std::make_pair(type, value));
 		}
 
-		inline std::string getProperty(PropertyType type)
+		inline std::string getProperty(PropertyType type) const
 		{
 			return map.at(type);
 		}
 
-		inline bool hasProperty(PropertyType type)
+		inline bool hasProperty(PropertyType type) const
 		{
 			return map.find(type) != map.end();
 		}
@@ -58,14 +60,6 @@ namespace TMX
 		DIAGONAL = rot(1 << 29)
 	};
 
-	enum TileType
-	{
-		TILE_TILE,
-		TILE_OBJECT,
-		TILE_PROPERTY_SHAPE
-	};
-
-
 	/**
 	 * Strips flip flags from gid, and returns the block type
 	 * @param flips [0] = horizontal, [1] = vertical, [2] = diagonal
@@ -73,30 +67,15 @@ namespace TMX
 	 */
 	int stripFlip(const int &gid, std::bitset<3> &flips);
 
+	/**
+	 * A raw gid decoded into its block type and flips. Layers only store the raw gids, so these are made on demand
+	 */
 	struct Tile
 	{
-		Tile() : Tile(TILE_TILE)
-		{
-		}
-
-		Tile(TileType type) : gid(0), tileType(type)
-		{
-		}
-
-		Tile(const std::string &id) : Tile(TILE_TILE, id)
-		{
-		}
-
-		Tile(TileType type, const std::string &id);
-
-		virtual ~Tile()
-		{
-		}
-
-		inline TileType getTileType() const
-		{
-			return tileType;
-		}
+		/**
+		 * @param id The raw gid from the map, with flip flags
+		 */
+		explicit Tile(rot id);
 
 		inline bool isFlipped() const
 		{
@@ -120,42 +99,62 @@ namespace TMX
 			return gid;
 		}
 
-		sf::Vector2f position;
-
 	private:
 		unsigned gid;
 		bool flipped;
-		TileType tileType;
 		int rotationAngle, flipGID;
 
 		void processRotation(std::bitset<3> rotation);
 	};
 
-	struct PropertyObject : Tile, PropertyOwner
+	/**
+	 * @return True if the given raw gid has any flip flags
+	 */
+	inline bool isFlipped(rot gid)
 	{
+		return (gid & (HORIZONTAL | VERTICAL | DIAGONAL)) != 0;
+	}
 
-		PropertyObject() : Tile(TILE_PROPERTY_SHAPE)
-		{ }
+	struct PropertyObject : PropertyOwner
+	{
+		PropertyObject() : position(), dimensions()
+		{
+		}
 
+		sf::Vector2f position;
 		sf::Vector2f dimensions;
 	};
 
-	struct Object : Tile
+	struct Object
 	{
-		Object(const std::string &id) : Tile(TILE_OBJECT, id)
+		rot gid;
+		sf::Vector2f position;
+		float rotationAnglef;
+
+		inline Tile getTile() const
 		{
+			return Tile(gid);
 		}
-
-		float rotationAnglef;
 	};
 
 	struct Layer : PropertyOwner
 	{
-		~Layer();
-
 		std::string name;
-		std::vector<Tile *> items;
 		bool visible;
+
+		// raw gids of a tile layer, in row order
+		std::vector<rot> gids;
+
+		// tiles placed freely in an object layer
+		std::vector<Object> objects;
+
+		// shapes with properties in an object layer
+		std::vector<PropertyObject> shapes;
+
+		inline Tile getTile(size_t index) const
+		{
+			return Tile(gids[index]);
+		}
 	};
 
 	struct TileMap : PropertyOwner
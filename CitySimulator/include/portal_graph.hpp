@@ -0,0 +1,96 @@
+#ifndef CITYSIMULATOR_PORTAL_GRAPH_HPP
+#define CITYSIMULATOR_PORTAL_GRAPH_HPP
+
+#include <unordered_map>
+#include "world.hpp"
+
+/**
+ * A part of a route that walks between two tile positions in the same world. Consecutive legs in different worlds
+ * are joined by a door
+ */
+struct RouteLeg
+{
+	World *world;
+	sf::Vector2f start;
+	sf::Vector2f end;
+
+	RouteLeg(World *world, const sf::Vector2f &start, const sf::Vector2f &end) : world(world), start(start), end(end)
+	{
+	}
+};
+
+/**
+ * A graph of every door in every world, so that routes between worlds only need to search the doors. Doors in the
+ * same world are joined by their walking distance, which is cached next to the world, and doors are joined to their
+ * partner in the other world
+ */
+class PortalGraph
+{
+public:
+	PortalGraph();
+
+	/**
+	 * Rebuilds the graph from the doors of the given worlds, using their navigation meshes
+	 */
+	void build(const std::vector<World *> &worlds);
+
+	/**
+	 * Finds the shortest route between two positions, possibly in different worlds. The walks to and from the doors
+	 * are estimated by their straight line distance
+	 * @return False if there is no route
+	 */
+	bool findRoute(World *startWorld, const sf::Vector2f &start, World *endWorld, const sf::Vector2f &end,
+				   std::vector<RouteLeg> &route) const;
+
+	size_t getNodeCount() const
+	{
+		return nodes.size();
+	}
+
+	size_t getEdgeCount() const
+	{
+		return edges.size();
+	}
+
+private:
+	struct Node
+	{
+		World *world;
+		Door *door;
+		sf::Vector2f position;
+		int region;
+		unsigned firstEdge;
+		unsigned edgeCount;
+	};
+
+	struct Edge
+	{
+		int target;
+		float cost;
+	};
+
+	float doorCost;
+
+	std::vector<Node> nodes;
+	std::vector<Edge> edges;
+	std::unordered_map<World *, std::vector<int>> worldNodes;
+
+	/**
+	 * Fills the walking distance between every pair of the given doors in the same world, or a negative number if
+	 * unreachable, from the cache if it matches
+	 */
+	void getDoorDistances(World *world, const std::vector<sf::Vector2f> &doors, std::vector<float> &distances) const;
+
+	static bool loadDistances(const std::string &path, const std::vector<sf::Vector2f> &doors,
+							  std::vector<float> &distances);
+
+	static bool saveDistances(const std::string &path, const std::vector<sf::Vector2f> &doors,
+							  const std::vector<float> &distances);
+
+	/**
+	 * @return The length of the shortest walk between the given positions, or a negative number if unreachable
+	 */
+	static float getWalkingDistance(World *world, const sf::Vector2f &start, const sf::Vector2f &end);
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef CITYSIMULATOR_SERIALIZATION_HPP
+#define CITYSIMULATOR_SERIALIZATION_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Writes plain old data to a binary file, in native byte order
+ */
+class BinaryWriter
+{
+public:
+	explicit BinaryWriter(const std::string &path);
+
+	/**
+	 * Writes the file type and version, which must match when read back
+	 */
+	void writeHeader(const std::string &magic, uint32_t version);
+
+	template<class T>
+	void write(const T &value)
+	{
+		stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	template<class T>
+	void writeVector(const std::vector<T> &values)
+	{
+		write(static_cast<uint32_t>(values.size()));
+		if (!values.empty())
+			stream.write(reinterpret_cast<const char *>(values.data()), sizeof(T) * values.size());
+	}
+
+	void writeString(const std::string &s);
+
+	/**
+	 * @return False if the file couldn't be opened or a write failed
+	 */
+	bool good() const
+	{
+		return stream.good();
+	}
+
+private:
+	std::ofstream stream;
+};
+
+/**
+ * Reads plain old data written by a BinaryWriter, throwing a runtime_error if the file ends early
+ */
+class BinaryReader
+{
+public:
+	explicit BinaryReader(const std::string &path);
+
+	/**
+	 * @return False if the file couldn't be opened, or doesn't have the given type and version
+	 */
+	bool readHeader(const std::string &magic, uint32_t version);
+
+	template<class T>
+	T read()
+	{
+		T value;
+		readBytes(reinterpret_cast<char *>(&value), sizeof(T));
+		return value;
+	}
+
+	template<class T>
+	void readVector(std::vector<T> &out)
+	{
+		uint32_t count = read<uint32_t>();
+		out.resize(count);
+		if (count != 0)
+			readBytes(reinterpret_cast<char *>(&out[0]), sizeof(T) * count);
+	}
+
+	std::string readString();
+
+private:
+	std::string path;
+	std::ifstream stream;
+
+	void readBytes(char *out, size_t count);
+};
+
+namespace Serialization
+{
+	/**
+	 * @return True if the given derived file exists and was modified after its source
+	 */
+	bool isUpToDate(const std::string &derivedPath, const std::string &sourcePath);
+
+	const uint64_t hashSeed = 14695981039346656037ULL;
+
+	/**
+	 * Hashes the given bytes with 64-bit FNV-1a, continuing from a previous hash if given
+	 */
+	uint64_t hash(const void *data, size_t length, uint64_t seed = hashSeed);
+
+	/**
+	 * Hashes the contents of the given file
+	 * @return False if the file couldn't be read
+	 */
+	bool hashFile(const std::string &path, uint64_t &out, uint64_t seed = hashSeed);
+}
+
+#endif
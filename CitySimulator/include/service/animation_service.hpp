@@ -4,6 +4,7 @@
 #include "base_service.hpp"
 #include "constants.hpp"
 #include "animation.hpp"
+#include "atlas_packer.hpp"
 
 class AnimationService : public BaseService
 {
@@ -18,20 +19,55 @@ public:
 
 	std::string getRandomAnimationName(EntityType entityType);
 
+	/**
+	 * Decodes and packs all queued sprites into a single spritesheet, or loads the spritesheet and animations from the
+	 * cache if neither the sprites nor the entity definitions have changed since it was written
+	 */
 	void processQueuedSprites();
 
+	/**
+	 * @return True if the last call to processQueuedSprites loaded from the cache
+	 */
+	bool isFromCache() const
+	{
+		return fromCache;
+	}
+
 private:
-	sf::Texture texture;
+	struct QueuedSprite
+	{
+		std::string path;
+		ConfigKeyValue tags;
+		EntityType entityType;
+		sf::Image image;
+
+		QueuedSprite(const std::string &path, const ConfigKeyValue &tags, EntityType entityType)
+				: path(path), tags(tags), entityType(entityType)
+		{
+		}
+	};
+
+	std::vector<sf::Texture> textures;
 	std::map<EntityType, std::unordered_map<std::string, Animation>> animations;
 
-	std::map<sf::Image *, std::pair<ConfigKeyValue, EntityType>> *preProcessImageData;
+	std::vector<QueuedSprite> queuedSprites;
 	bool processed;
+	bool fromCache;
 
 	void checkProcessed(bool shouldBe);
 
 	sf::Vector2i stringToVector(const std::string &s);
 
-	void positionImages(sf::Vector2i &imageSize, std::map<sf::Image *, sf::IntRect> &imagePositions);
+	/**
+	 * Packs the queued sprites into as few spritesheet pages as possible
+	 */
+	void positionImages(std::vector<sf::Vector2u> &pageSizes, std::vector<AtlasPacker::Placement> &placements);
+
+	bool hashQueuedSprites(uint64_t &out);
+
+	bool loadCache(const std::string &path, uint64_t key);
+
+	void saveCache(const std::string &path, uint64_t key, const std::vector<sf::Image> &pages);
 };
 
 #endif
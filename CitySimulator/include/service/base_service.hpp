@@ -9,6 +9,7 @@ enum ServiceType
 {
 	SERVICE_ANIMATION,
 	SERVICE_CAMERA,
+	SERVICE_CLOCK,
 	SERVICE_CONFIG,
 	SERVICE_ENTITY,
 	SERVICE_EVENT,
@@ -31,6 +31,16 @@ public:
 	// merci: https://github.com/SFML/SFML/wiki/Source:-Zoom-View-At-(specified-pixel)
 	void zoomTo(float delta, const sf::Vector2i &pixel, sf::RenderWindow &window);
 
+	const sf::View &getView() const
+	{
+		return view;
+	}
+
+	World *getWorld() const
+	{
+		return world;
+	}
+
 private:
 	World *world;
 	PhysicsComponent *trackedEntity;
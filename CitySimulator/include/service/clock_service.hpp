@@ -0,0 +1,120 @@
+#ifndef CITYSIMULATOR_CLOCK_SERVICE_HPP
+#define CITYSIMULATOR_CLOCK_SERVICE_HPP
+
+#include <queue>
+#include <vector>
+#include "base_service.hpp"
+
+typedef int EntityID;
+
+/**
+ * Keeps the simulated time of day, and wakes sleeping entities when their scheduled time comes. Only the entities
+ * that are awake are visited each frame, so sleeping ones cost nothing in the meantime
+ */
+class ClockService : public BaseService
+{
+public:
+	ClockService();
+
+	virtual void onEnable() override;
+
+	void tick(float delta);
+
+	/**
+	 * @return The number of simulated seconds since midnight on the first day
+	 */
+	double getTime() const
+	{
+		return time;
+	}
+
+	/**
+	 * @return The current hour of the day, in the range [0, 24)
+	 */
+	float getHourOfDay() const;
+
+	unsigned getDay() const;
+
+	/**
+	 * @return The time at which the given hour of the day is next reached
+	 */
+	double getNextTimeOfHour(float hour) const;
+
+	void setTime(double time);
+
+	void setTimeScale(float timeScale);
+
+	/**
+	 * Starts keeping track of the given entity, which is awake until it's put to sleep
+	 */
+	void addEntity(EntityID entity);
+
+	/**
+	 * Stops keeping track of the given entity, cancelling its scheduled wake up
+	 */
+	void removeEntity(EntityID entity);
+
+	/**
+	 * @return Every tracked entity that isn't asleep, in no particular order
+	 */
+	const std::vector<EntityID> &getAwakeEntities() const
+	{
+		return awake;
+	}
+
+	/**
+	 * Puts the given entity to sleep until the given time, replacing any previously scheduled wake up
+	 */
+	void scheduleWake(EntityID entity, double wakeTime);
+
+	/**
+	 * Wakes the given entity immediately, cancelling its scheduled wake up
+	 */
+	void cancelWake(EntityID entity);
+
+	inline bool isSleeping(EntityID entity) const
+	{
+		return entity >= 0 && entity < static_cast<EntityID>(sleeping.size()) && sleeping[entity];
+	}
+
+	unsigned getSleepingCount() const
+	{
+		return sleepingCount;
+	}
+
+private:
+	struct WakeUp
+	{
+		double time;
+		EntityID entity;
+
+		// lazily cancelled if it doesn't match the entity's current generation
+		unsigned generation;
+
+		bool operator>(const WakeUp &other) const
+		{
+			return time > other.time;
+		}
+	};
+
+	double time;
+	float timeScale;
+
+	std::priority_queue<WakeUp, std::vector<WakeUp>, std::greater<WakeUp>> wakeUps;
+	std::vector<unsigned> generations;
+	std::vector<bool> sleeping;
+	unsigned sleepingCount;
+
+	// index of every tracked entity in the awake list, or -1 if asleep or untracked
+	std::vector<EntityID> awake;
+	std::vector<int> awakeIndices;
+	std::vector<bool> tracked;
+
+	void ensureCapacity(EntityID entity);
+
+	void wake(EntityID entity);
+
+	void removeAwake(EntityID entity);
+};
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "base_service.hpp"
 #include "ecs.hpp"
+#include "behaviour.hpp"
+#include "spatial.hpp"
 #include "world.hpp"
 
 const unsigned int MAX_ENTITIES = 1024;
@@ -35,6 +37,19 @@ public:
 
 	boost::optional<EntityIdentifier *> getEntityIDFromBody(const b2Body &body);
 
+	/**
+	 * @return The loaded behaviour tree with the given name, or nullptr if not found
+	 */
+	const BehaviourTree *getBehaviour(const std::string &name) const;
+
+	/**
+	 * @return The positions of all physics entities in tiles, as of the last physics system tick
+	 */
+	SpatialGrid &getSpatialGrid()
+	{
+		return spatialGrid;
+	}
+
 	// systems
 	void tickSystems(float delta);
 
@@ -61,7 +76,11 @@ public:
 
 	void addPlayerInputComponent(EntityID e);
 
-	void addAIInputComponent(EntityID e);
+	/**
+	 * Adds an AI brain, that follows the given behaviour tree
+	 * @param behaviour The behaviour's name, or empty for the default
+	 */
+	void addAIInputComponent(EntityID e, const std::string &behaviour = "");
 
 private:
 	EntityID entities[MAX_ENTITIES];
@@ -74,6 +93,9 @@ private:
 
 	void loadEntities(ConfigurationFile &config, EntityType entityType, const std::string &sectionName);
 
+	// shared between all brains
+	BehaviourTrees behaviours;
+
 	// components
 	PhysicsComponent physicsComponents[MAX_ENTITIES];
 	RenderComponent renderComponents[MAX_ENTITIES];
@@ -82,9 +104,15 @@ private:
 	// systems
 	std::vector<System *> systems;
 	RenderSystem *renderSystem;
+	SpatialGrid spatialGrid;
 
 	// helpers
 	BaseComponent *addComponent(EntityID e, ComponentType type);
+
+	/**
+	 * Has the clock keep the entity's brain awake until it sleeps
+	 */
+	void trackBrain(EntityID e);
 };
 
 #endif
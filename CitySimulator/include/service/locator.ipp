@@ -1,6 +1,7 @@
 #include <typeinfo>
 #include "animation_service.hpp"
 #include "camera_service.hpp"
+#include "clock_service.hpp"
 #include "config_service.hpp"
 #include "entity_service.hpp"
 #include "event_service.hpp"
@@ -19,6 +20,8 @@ T *Locator::locate(bool errorOnFail)
 		type = SERVICE_ANIMATION;
 	else if (typeid(T) == typeid(CameraService))
 		type = SERVICE_CAMERA;
+	else if (typeid(T) == typeid(ClockService))
+		type = SERVICE_CLOCK;
 	else if (typeid(T) == typeid(ConfigService))
 		type = SERVICE_CONFIG;
 	else if (typeid(T) == typeid(EntityService))
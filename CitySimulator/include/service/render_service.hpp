@@ -9,12 +9,32 @@ class RenderService : public BaseService
 public:
 	RenderService(sf::RenderWindow *renderWindow);
 
+	/**
+	 * Renders offscreen into the given texture, with no window
+	 */
+	explicit RenderService(sf::RenderTexture &renderTexture);
+
 	virtual void onEnable() override;
 
 	void render(const World &world);
 
+	/**
+	 * @return The window, or nullptr if headless
+	 */
 	sf::RenderWindow *getWindow();
 
+	/**
+	 * @return The window or offscreen texture that everything is drawn to
+	 */
+	sf::RenderTarget *getTarget();
+
+	/**
+	 * Closes the window, or stops the headless game loop
+	 */
+	void close();
+
+	bool isOpen() const;
+
 	sf::Vector2f mapScreenToWorld(const sf::Vector2i &screenPos);
 
 	inline void setView(sf::View &view)
@@ -22,9 +42,32 @@ public:
 		this->view = &view;
 	}
 
+	/**
+	 * Counts draw calls and vertices submitted this frame, which are reset at the start of every render
+	 */
+	inline void countDraws(std::size_t drawCalls, std::size_t vertices)
+	{
+		this->drawCalls += drawCalls;
+		submittedVertices += vertices;
+	}
+
+	inline std::size_t getDrawCalls() const
+	{
+		return drawCalls;
+	}
+
+	inline std::size_t getSubmittedVertices() const
+	{
+		return submittedVertices;
+	}
+
 private:
 	sf::RenderWindow *window;
+	sf::RenderTarget *target;
+	bool open;
 	sf::View *view;
+	std::size_t drawCalls;
+	std::size_t submittedVertices;
 
 	void limitView(const World &world);
 };
@@ -5,6 +5,7 @@
 #include "world.hpp"
 #include "building.hpp"
 #include "bodydata.hpp"
+#include "portal_graph.hpp"
 
 class WorldService : public BaseService
 {
@@ -17,9 +18,15 @@ public:
 
 	World &getWorld();
 
+	/**
+	 * @return The graph of doors between all loaded worlds
+	 */
+	const PortalGraph &getPortalGraph() const;
+
 private:
 	// todo 1 main world, list of auxiliary worlds (or tree?)
 	World world;
+	PortalGraph portalGraph;
 
 	std::string worldPath, tilesetPath;
 
@@ -0,0 +1,69 @@
+#ifndef CITYSIMULATOR_SPATIAL_HPP
+#define CITYSIMULATOR_SPATIAL_HPP
+
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+
+typedef int EntityID;
+
+/**
+ * A uniform grid of entity positions, hashed into a fixed number of buckets so that it works for any world size.
+ * Positions are inserted then sorted into their buckets in one go with rebuild, after which the grid can be queried
+ */
+class SpatialGrid
+{
+public:
+	explicit SpatialGrid(float cellSize = 4.f, unsigned bucketCount = 1024);
+
+	/**
+	 * Removes all entities
+	 */
+	void clear();
+
+	/**
+	 * Queues an entity to be added on the next rebuild
+	 */
+	void insert(EntityID entity, const sf::Vector2f &position);
+
+	/**
+	 * Sorts all inserted entities into their buckets
+	 */
+	void rebuild();
+
+	/**
+	 * Appends all entities whose position lies within the given area, as of the last rebuild
+	 */
+	void query(const sf::FloatRect &area, std::vector<EntityID> &out) const;
+
+	float getCellSize() const
+	{
+		return cellSize;
+	}
+
+	size_t getEntityCount() const
+	{
+		return entries.size();
+	}
+
+private:
+	struct Entry
+	{
+		EntityID entity;
+		sf::Vector2f position;
+		int cellX, cellY;
+	};
+
+	float cellSize;
+	unsigned bucketCount;
+
+	std::vector<Entry> pending;
+	std::vector<Entry> entries;
+	std::vector<unsigned> bucketStarts;
+	std::vector<unsigned> bucketCursors;
+
+	int toCell(float coord) const;
+
+	unsigned hashCell(int x, int y) const;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef CITYSIMULATOR_SPRITE_BATCH_HPP
+#define CITYSIMULATOR_SPRITE_BATCH_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Collects textured quads over a frame and draws them with as few draw calls as possible. Consecutive sprites that
+ * share a texture are drawn together, so sprites from a single atlas take one draw call. If depth sorted, sprites are
+ * drawn from the top of the screen to the bottom by the bottom edge of their quad, so that sprites further south are
+ * drawn in front
+ */
+class SpriteBatch
+{
+public:
+	explicit SpriteBatch(std::size_t capacity = 0, bool depthSorted = false);
+
+	/**
+	 * Removes all sprites from the last frame
+	 */
+	void begin();
+
+	/**
+	 * Adds a quad, transformed and textured by the given states
+	 */
+	void add(const sf::Vertex *quad, const sf::RenderStates &states);
+
+	/**
+	 * Draws every sprite added since begin
+	 * @return The number of draw calls made
+	 */
+	std::size_t end(sf::RenderTarget &target, sf::RenderStates states = sf::RenderStates::Default);
+
+	/**
+	 * Orders the sprites by depth with a stable radix sort on their quantised depths, called by end if depth sorted
+	 */
+	void sort();
+
+	/**
+	 * @return The indices of the sprites in the order they will be drawn, as of the last sort
+	 */
+	const std::vector<unsigned> &getOrder() const
+	{
+		return order;
+	}
+
+	std::size_t getSpriteCount() const
+	{
+		return textures.size();
+	}
+
+private:
+	bool depthSorted;
+
+	std::vector<sf::Vertex> vertices;
+	std::vector<const sf::Texture *> textures;
+	std::vector<float> depths;
+
+	// sorting
+	std::vector<uint16_t> keys;
+	std::vector<unsigned> order;
+	std::vector<unsigned> scratch;
+	std::vector<sf::Vertex> sortedVertices;
+};
+
+#endif
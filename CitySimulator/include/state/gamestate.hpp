@@ -15,7 +15,7 @@ public:
 
 	virtual void tick(float delta) override;
 
-	virtual void render(sf::RenderWindow &window) override;
+	virtual void render(sf::RenderTarget &target) override;
 
 	b2World *getBox2DWorld();
 
@@ -3,7 +3,7 @@
 
 namespace sf
 {
-	class RenderWindow;
+	class RenderTarget;
 }
 
 enum StateType
@@ -30,7 +30,7 @@ public:
 
 	virtual void tick(float delta) = 0;
 
-	virtual void render(sf::RenderWindow &window) = 0;
+	virtual void render(sf::RenderTarget &target) = 0;
 
 	const StateType type;
 	bool showMouse;
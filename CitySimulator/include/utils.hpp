@@ -166,6 +166,12 @@ namespace Math
 		return sqrtf(lengthSquared(v));
 	}
 
+	template<class V=float>
+	float distance(const sf::Vector2<V> &a, const sf::Vector2<V> &b)
+	{
+		return length(b - a);
+	}
+
 	template<class V=float>
 	sf::Vector2<V> normalize(const sf::Vector2<V> &v)
 	{
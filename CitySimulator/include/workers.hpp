@@ -0,0 +1,54 @@
+#ifndef CITYSIMULATOR_WORKERS_HPP
+#define CITYSIMULATOR_WORKERS_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads that split batches of work between them
+ */
+class WorkerPool
+{
+public:
+	/**
+	 * @param threadCount The number of worker threads to spawn, or 0 to use one less than the number of cores
+	 */
+	explicit WorkerPool(unsigned threadCount = 0);
+
+	~WorkerPool();
+
+	/**
+	 * Splits [0, count) into contiguous ranges and runs the task over them on all workers and the calling thread,
+	 * blocking until every range has finished. The first exception thrown by a task is rethrown here
+	 * @param minBatch The smallest range worth handing to another thread
+	 */
+	void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &task, size_t minBatch = 16);
+
+	unsigned getThreadCount() const
+	{
+		return static_cast<unsigned>(threads.size());
+	}
+
+private:
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	std::deque<std::function<void()>> jobs;
+	size_t unfinishedJobs;
+	std::exception_ptr firstError;
+	bool stopping;
+
+	void workerLoop();
+
+	void runJob(const std::function<void()> &job);
+};
+
+#endif
@@ -3,11 +3,13 @@
 
 #include <SFML/Graphics.hpp>
 #include <Box2D/Box2D.h>
+#include <memory>
 #include <unordered_map>
 #include <set>
 #include <boost/optional.hpp>
 #include "SFMLDebugDraw.h"
 #include "maploader.hpp"
+#include "compiled_world.hpp"
 #include "building.hpp"
 #include "bodydata.hpp"
 
@@ -76,32 +78,81 @@ public:
 
 	void load(const std::string &path);
 
+	/**
+	 * Loads the tileset and converts it to a texture with the given flipped tiles, using the cached texture from a
+	 * previous run if the tileset and flipped tiles are unchanged
+	 */
+	void loadConverted(const std::string &path, const std::vector<int> &flippedGIDs);
+
+	/**
+	 * Does the image work of loadConverted without touching the texture, so it can run on another thread
+	 */
+	void prepare(const std::string &path, const std::vector<int> &flippedGIDs, bool useCache);
+
+	/**
+	 * Uploads the prepared tileset to its texture, on the main thread
+	 */
+	void upload();
+
 	void textureQuad(sf::Vertex *quad, const BlockType &blockType, int rotationAngle, int flipGID);
 
+	/**
+	 * @return True if the given tile has no transparent pixels, so hides everything beneath it
+	 */
+	bool isOpaque(const BlockType &blockType, int flipGID) const;
+
 	sf::Texture *getTexture() const;
 
 	sf::Image *getImage() const;
 
 	sf::Vector2u getSize() const;
 
-	void convertToTexture(const std::vector<int> &flippedGIDs);
-
 	sf::IntRect getTileRect(unsigned blockType);
 
 	void createTileImage(sf::Image *image, unsigned blockType);
 
+	/**
+	 * @return True if the texture was loaded from the cache by loadConverted
+	 */
+	bool isFromCache() const
+	{
+		return fromCache;
+	}
+
 protected:
 	friend class WorldTerrain;
 
 private:
 	sf::Image *image;
+	sf::Image atlas;
 	sf::Texture texture;
 	sf::Vector2f *points;
 	sf::Vector2u size;
 
 	std::unordered_map<int, int> flippedBlockTypes;
+	std::vector<bool> opaqueTiles;
 	bool converted;
 
+	// cache
+	std::string cachePath;
+	uint64_t cacheKey;
+	bool fromCache;
+
+	void convertImage(const std::vector<int> &flippedGIDs);
+
+	void findOpaqueTiles();
+
+	int getBlockID(const BlockType &blockType, int flipGID) const;
+
+	bool loadCache();
+
+	void saveCache();
+
+	/**
+	 * Removes the tileset's caches that were made from an older version of its image, keeping every other world's
+	 */
+	void removeStaleCaches(const std::string &path, uint64_t imageKey);
+
 	void addPoint(int x, int y);
 
 	void generatePoints();
@@ -151,6 +202,64 @@ struct WorldLayer
 	}
 };
 
+/**
+ * A square of tiles whose vertices are drawn together, so only the chunks in view need to be drawn
+ */
+struct TerrainChunk
+{
+	enum Coverage
+	{
+		COVERAGE_EMPTY,
+		COVERAGE_PARTIAL,
+		COVERAGE_OPAQUE
+	};
+
+	sf::IntRect bounds;
+
+	/**
+	 * Every layer's quads in fixed slots that tiles are written to, with how much of its slot each tile covers
+	 */
+	sf::VertexArray tileSlots;
+	sf::VertexArray overLayerSlots;
+	std::vector<unsigned char> tileCoverage;
+	std::vector<unsigned char> overLayerCoverage;
+
+	/**
+	 * Only the tiles that aren't hidden under opaque tiles, rebuilt from the slots whenever they change
+	 */
+	sf::VertexArray tileVertices;
+	sf::VertexArray objectVertices;
+	sf::VertexArray overLayerVertices;
+
+	/**
+	 * Incremented whenever the vertices change, so baked images know when they are stale
+	 */
+	unsigned revision;
+
+	explicit TerrainChunk(const sf::IntRect &bounds) : bounds(bounds), tileSlots(sf::Quads), overLayerSlots(sf::Quads),
+													   tileVertices(sf::Quads), objectVertices(sf::Quads),
+													   overLayerVertices(sf::Quads), revision(0)
+	{
+	}
+};
+
+/**
+ * Downsampled images of a chunk for drawing when zoomed far out, where level n is 2^n times smaller than the tiles
+ */
+struct BakedChunk
+{
+	std::vector<sf::Texture> groundLevels;
+
+	// empty if the chunk has nothing over the terrain
+	std::vector<sf::Texture> overLevels;
+	unsigned revision;
+	bool baked;
+
+	BakedChunk() : revision(0), baked(false)
+	{
+	}
+};
+
 /**
  * A world item that holds the block type of every tile in the world
  */
@@ -162,42 +271,114 @@ public:
 
 	~WorldTerrain();
 
+	/**
+	 * Sets the block type immediately, but queues the vertex update until the next call to applyChanges
+	 */
 	void setBlockType(const sf::Vector2i &pos, BlockType blockType, LayerType layer = LAYER_TERRAIN,
 					  int rotationAngle = 0, int flipGID = 0);
 
+	/**
+	 * Writes the vertices of every tile changed since the last call, one chunk at a time
+	 * @return The number of chunks that were rebuilt
+	 */
+	int applyChanges();
+
+	std::size_t getPendingChangeCount() const
+	{
+		return pendingTiles.size();
+	}
+
+	/**
+	 * @return The number of tile vertices drawn when every chunk is in view
+	 */
+	std::size_t getTileVertexCount() const;
+
+	/**
+	 * @return The baked level to draw chunks with at the given on-screen tile size, or 0 to draw every tile
+	 */
+	int getDetailLevel(float pixelsPerTile) const;
+
 	void addObject(const sf::Vector2f &pos, BlockType blockType, float rotationAngle, int flipGID);
 
 	const std::vector<WorldObject> &getObjects();
 
 	const std::vector<WorldLayer> &getLayers();
 
+	/**
+	 * Finds the visible layers of the given map, with their tiles, objects and flipped tiles
+	 * @param tiles The gids of each tile layer in turn
+	 */
+	static void compile(const TMX::TileMap &tileMap, std::vector<CompiledWorld::Layer> &layers,
+						std::vector<int32_t> &flippedGIDs, std::vector<TMX::rot> &tiles,
+						std::vector<CompiledWorld::Object> &objects);
+
 private:
+	struct PendingTile
+	{
+		sf::Vector2i pos;
+		BlockType blockType;
+		LayerType layer;
+		int rotationAngle;
+		int flipGID;
+		int chunk;
+	};
+
 	Tileset tileset;
-	sf::VertexArray tileVertices;
-	sf::VertexArray overLayerVertices;
+	std::vector<TerrainChunk> chunks;
+	sf::Vector2i chunkCount;
+	int chunkSize;
+
+	float detailThreshold;
+	int detailLevels;
+	int bakesPerFrame;
+	mutable std::vector<BakedChunk> bakedChunks;
+	mutable std::vector<std::unique_ptr<sf::RenderTexture>> bakeTargets;
 
 	std::vector<BlockType> blockTypes;
+	std::unordered_map<int, PendingTile> pendingTiles;
 	std::vector<WorldObject> objects;
 	std::vector<WorldLayer> layers;
 
 	int tileLayerCount;
 	int overLayerCount;
 
-	void discoverLayers(std::vector<TMX::Layer *> &layers, std::vector<LayerType> &layerTypes);
+	static void discoverFlippedTiles(const std::vector<const TMX::Layer *> &layers, std::vector<int32_t> &flippedGIDs);
 
-	void discoverFlippedTiles(const std::vector<TMX::Layer *> &layers, std::vector<int> &flippedGIDs);
-
-	void addTiles(const std::vector<TMX::Layer *> &layers, const std::vector<LayerType> &types);
+	void addTiles(const CompiledWorld &compiled);
 
 	int getBlockIndex(const sf::Vector2i &pos, LayerType layerType);
 
 	int getVertexIndex(const sf::Vector2i &pos, LayerType layerType);
 
+	int getChunkIndex(const sf::Vector2i &pos) const;
+
+	TerrainChunk &getChunk(const sf::Vector2i &pos);
+
+	void writeTile(const sf::Vector2i &pos, BlockType blockType, LayerType layer, int rotationAngle, int flipGID);
+
 	void rotateObject(sf::Vertex *quad, float degrees, const sf::Vector2f &pos);
 
 	void positionVertices(sf::Vertex *quad, const sf::Vector2f &pos, int delta);
 
-	sf::VertexArray &getVertices(const LayerType &layerType);
+	sf::VertexArray &getVertices(const sf::Vector2i &pos, const LayerType &layerType);
+
+	std::vector<unsigned char> &getCoverage(const sf::Vector2i &pos, const LayerType &layerType);
+
+	/**
+	 * Rebuilds the chunk's drawn tile vertices, leaving out empty slots and tiles beneath opaque ones
+	 */
+	void cullHiddenTiles(TerrainChunk &chunk);
+
+	/**
+	 * @return The given chunk's image at the given level, re-baking it first if stale and bakes remain this frame,
+	 * otherwise nullptr
+	 */
+	const sf::Texture *getBakedTexture(int chunkIndex, int level, bool overLayers, int &bakesLeft) const;
+
+	/**
+	 * Renders the chunk at full resolution, then halves it into each level on the gpu
+	 */
+	bool bakeLevels(const TerrainChunk &chunk, bool overLayers, std::vector<sf::Texture> &levels) const;
 
 protected:
 
@@ -205,11 +386,12 @@ protected:
 
 	void registerLayer(LayerType layerType, int depth);
 
+	/**
+	 * Draws the chunks that intersect the target's view
+	 */
 	void render(sf::RenderTarget &target, sf::RenderStates &states, bool overLayers) const;
 
-	void load(const TMX::TileMap *tileMap, const std::string &tilesetPath);
-
-	friend struct TMX::TileMap;
+	void load(const CompiledWorld &compiled, const std::string &tilesetPath);
 
 	friend class World;
 };
@@ -233,8 +415,25 @@ public:
 
 	bool getRectAt(const sf::Vector2i &tilePos, sf::FloatRect &ret);
 
+	/**
+	 * @return The pixel bounds of all static collision rectangles that can't be walked through
+	 */
+	const std::vector<sf::FloatRect> &getBlockingRects() const;
+
+	/**
+	 * Draws the fixtures in view if debug.render-physics is enabled
+	 */
+	void renderDebug();
+
+	/**
+	 * Finds the collision boxes of the given terrain and objects, merging adjacent solid tiles
+	 * @param terrain The block type of every tile in the terrain layer, in row-major order
+	 */
+	static void compile(const sf::Vector2i &tileSize, const std::vector<BlockType> &terrain,
+						const std::vector<WorldObject> &objects, std::vector<CompiledWorld::CollisionRect> &out);
+
 protected:
-	void load();
+	void load(const CompiledWorld &compiled);
 
 	b2World world;
 	b2Body *worldBody;
@@ -269,12 +468,14 @@ private:
 
 	boost::optional<SFMLDebugDraw> b2Renderer;
 	std::multimap<sf::Vector2i, sf::FloatRect> cellGrid;
+	std::vector<sf::FloatRect> blockingRects;
 
-	void findCollidableTiles(std::vector<CollisionRect> &rects) const;
+	static void findCollidableTiles(const sf::Vector2i &tileSize, const std::vector<BlockType> &terrain,
+									const std::vector<WorldObject> &objects, std::vector<CollisionRect> &rects);
 
-	void mergeAdjacentTiles(std::vector<CollisionRect> &rects, std::vector<sf::FloatRect> &ret);
+	static void mergeAdjacentTiles(std::vector<CollisionRect> &rects);
 
-	void mergeHelper(std::vector<sf::FloatRect> &rects, bool moveOnIfFar);
+	static void mergeHelper(std::vector<sf::FloatRect> &rects, bool moveOnIfFar);
 
 	BodyData *createBodyData(BlockType blockType, const sf::Vector2i &tilePos);
 };
@@ -289,17 +490,130 @@ public:
 	{
 	}
 
-	void load(const TMX::TileMap &tileMap, std::vector<std::string> &worldsToLoad);
+	void load(const CompiledWorld &compiled, std::vector<std::string> &worldsToLoad);
+
+	/**
+	 * Finds the buildings and doors in the given map's buildings layer
+	 * @param strings Where the names of the buildings' inside worlds are appended
+	 */
+	static void compile(const TMX::TileMap &tileMap, std::vector<CompiledWorld::Building> &buildings,
+						std::vector<CompiledWorld::Door> &doors, std::string &strings);
 
 	void getBuildingByOutsideDoorTile(const sf::Vector2i &tile, boost::optional<std::pair<Building *, Door *>> &out);
 
 	Building *getBuildingByID(int id);
 
+	/**
+	 * Adds a building in this world, replacing any with the same ID
+	 */
+	Building &addBuilding(int id, const sf::IntRect &tileBounds, const std::string &insideWorldName);
+
+	void getBuildings(std::vector<Building *> &out);
+
 private:
 	std::unordered_map<int, Building> buildings;
+};
+
+/**
+ * A world item that divides the walkable tiles into convex polygons, connected by portals along their shared edges.
+ * Paths are searched over the polygons, then smoothed with the funnel algorithm
+ */
+class NavigationMesh : public BaseWorld
+{
+public:
+	explicit NavigationMesh(World *container) : BaseWorld(container)
+	{
+	}
+
+	/**
+	 * Builds the mesh from scratch
+	 * @param size The size of the world in tiles
+	 * @param blocked If each tile can't be walked on, in row-major order
+	 */
+	void generate(const sf::Vector2i &size, const std::vector<bool> &blocked);
+
+	/**
+	 * @return The index of the polygon containing the given tile position, or -1 if it isn't walkable
+	 */
+	int findPolygon(const sf::Vector2f &tilePos) const;
+
+	/**
+	 * @return The region of connected polygons containing the given tile position, or -1 if it isn't walkable. Two
+	 * positions can only be walked between if they are in the same region
+	 */
+	int findRegion(const sf::Vector2f &tilePos) const;
+
+	/**
+	 * Finds the shortest path between two tile positions
+	 * @param path Filled with the waypoints, starting with start and ending with end
+	 * @param clearance How far the path should keep away from the corners of obstacles, in tiles
+	 * @return False if either position isn't walkable, or there is no path between them
+	 */
+	bool findPath(const sf::Vector2f &start, const sf::Vector2f &end, std::vector<sf::Vector2f> &path,
+				  float clearance = 0.4f) const;
+
+	size_t getPolygonCount() const
+	{
+		return polygons.size();
+	}
+
+	size_t getPortalCount() const
+	{
+		return portals.size() / 2;
+	}
+
+	/**
+	 * Writes the mesh to the given cache file
+	 */
+	bool save(const std::string &path) const;
+
+	/**
+	 * Replaces the mesh with the one in the given cache file
+	 * @return False if the cache is missing, out of date or for a different size world
+	 */
+	bool loadCache(const std::string &path, const sf::Vector2i &expectedSize);
+
+protected:
+	void load(const std::string &worldPath);
+
+	friend class World;
+
+private:
+	struct Polygon
+	{
+		sf::IntRect bounds;
+		unsigned firstPortal;
+		unsigned portalCount;
+	};
+
+	/**
+	 * One side of the shared edge between two polygons
+	 */
+	struct Portal
+	{
+		int neighbour;
+		sf::Vector2f start;
+		sf::Vector2f end;
+	};
+
+	sf::Vector2i size;
+	std::vector<Polygon> polygons;
+	std::vector<Portal> portals;
+
+	// polygon index for every tile, or -1 if blocked
+	std::vector<int> polygonGrid;
 
-	void gatherBuildings(TMX::Layer *buildingLayer);
+	// region of every polygon
+	std::vector<int> regions;
 
+	void fillGrid(int polygon);
+
+	void findPortals();
+
+	void findRegions();
+
+	void funnel(const std::vector<std::pair<sf::Vector2f, sf::Vector2f>> &corridor,
+				std::vector<sf::Vector2f> &path) const;
 };
 
 class World : public sf::Drawable
@@ -307,8 +621,21 @@ class World : public sf::Drawable
 public:
 	World();
 
+	/**
+	 * Loads the given world's compiled file if it is newer than the map, otherwise compiles the map first
+	 */
 	void loadFromFile(const std::string &filename, const std::string &tileset, std::vector<std::string> &worldsToLoad);
 
+	/**
+	 * @return The path of the compiled file for the given map
+	 */
+	static std::string getCompiledPath(const std::string &mapPath);
+
+	/**
+	 * @return The path of the map this world was loaded from, or an empty string if it wasn't loaded from a file
+	 */
+	const std::string &getFilePath() const;
+
 	void resize(sf::Vector2i size);
 
 	WorldTerrain &getTerrain();
@@ -317,6 +644,8 @@ public:
 
 	BuildingMap &getBuildingMap();
 
+	NavigationMesh &getNavigationMesh();
+
 	b2World *getBox2DWorld();
 
 	sf::Vector2i getPixelSize() const;
@@ -335,10 +664,12 @@ private:
 	WorldTerrain terrain;
 	CollisionMap collisionMap;
 	BuildingMap buildingMap;
+	NavigationMesh navigationMesh;
 
 	void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
 
 protected:
+	std::string filePath;
 	sf::Vector2i tileSize;
 	sf::Vector2i pixelSize;
 	sf::Transform transform;
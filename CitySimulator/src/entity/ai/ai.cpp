@@ -26,14 +26,125 @@ void Brain::tick(float delta)
 }
 
 
-EntityBrain::EntityBrain(EntityID e)
+EntityBrain::EntityBrain(EntityID e, const BehaviourTree *behaviour) : behaviour(behaviour)
 {
 	setEntity(e);
+	steering.setEntity(phys);
+}
+
+EntityBrain::~EntityBrain()
+{
+	ClockService *clock = Locator::locate<ClockService>(false);
+	if (clock != nullptr)
+		clock->cancelWake(entity);
+}
+
+bool EntityBrain::wantsToThink() const
+{
+	return behaviour != nullptr && blackboard.status != STATUS_RUNNING;
+}
+
+void EntityBrain::think()
+{
+	BehaviourNodeIndex next = behaviour->think(blackboard);
+
+	if (next != INVALID_BEHAVIOUR_NODE)
+		startAction(behaviour->getNode(next));
+}
+
+bool EntityBrain::isIdle() const
+{
+	if (behaviour == nullptr || blackboard.status != STATUS_RUNNING)
+		return true;
+
+	BehaviourNodeType type = behaviour->getNode(blackboard.action).type;
+	return type == BEHAVIOUR_WAIT || type == BEHAVIOUR_SLEEP_UNTIL;
+}
+
+void EntityBrain::startAction(const BehaviourNode &action)
+{
+	blackboard.timer = 0.f;
+
+	switch (action.type)
+	{
+		case BEHAVIOUR_WANDER:
+		{
+			float angle = Utils::random<float>(0.f, static_cast<float>(2 * Math::PI));
+			float distance = Utils::random(0.f, action.params[0]);
+
+			sf::Vector2f pos(phys->getTilePosition());
+			blackboard.target = {pos.x + std::cos(angle) * distance, pos.y + std::sin(angle) * distance};
+			steering.setTarget(blackboard.target);
+			break;
+		}
+
+		case BEHAVIOUR_WAIT:
+			blackboard.timer = Utils::random(action.params[0], action.params[1]);
+			break;
+
+		case BEHAVIOUR_SLEEP_UNTIL:
+		{
+			ClockService *clock = Locator::locate<ClockService>(false);
+			if (clock == nullptr)
+			{
+				blackboard.status = STATUS_FAILURE;
+				break;
+			}
+
+			// won't be ticked again until woken
+			clock->scheduleWake(entity, clock->getNextTimeOfHour(action.params[0]));
+			controller->halt();
+			phys->desiredSteering.SetZero();
+			break;
+		}
+
+		default:
+			break;
+	}
 }
 
 void EntityBrain::tickBrain(float delta)
 {
-	// todo tick behaviours, which tick steerings
+	// carry on with the current action, even if it's waiting for its turn to think
+	if (blackboard.status != STATUS_RUNNING || blackboard.action == INVALID_BEHAVIOUR_NODE)
+		return;
+
+	const BehaviourNode &action = behaviour->getNode(blackboard.action);
+	switch (action.type)
+	{
+		case BEHAVIOUR_WANDER:
+		{
+			b2Vec2 steer;
+			steering.tick(steer, delta);
+
+			blackboard.timer += delta;
+			if (steer.x == 0.f && steer.y == 0.f)
+				blackboard.status = STATUS_SUCCESS;
+			else if (blackboard.timer >= action.params[1])
+				blackboard.status = STATUS_FAILURE;
+			else
+				controller->move(Utils::fromB2Vec<float>(steer));
+			break;
+		}
+
+		case BEHAVIOUR_WAIT:
+			blackboard.timer -= delta;
+			if (blackboard.timer <= 0.f)
+				blackboard.status = STATUS_SUCCESS;
+			break;
+
+		case BEHAVIOUR_SLEEP_UNTIL:
+		{
+			ClockService *clock = Locator::locate<ClockService>(false);
+			if (clock == nullptr || !clock->isSleeping(entity))
+				blackboard.status = STATUS_SUCCESS;
+			break;
+		}
+
+		default:
+			blackboard.status = STATUS_FAILURE;
+			break;
+	}
 }
 
 InputBrain::InputBrain(EntityID e)
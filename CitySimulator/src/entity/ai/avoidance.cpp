@@ -0,0 +1,380 @@
+#include <algorithm>
+#include "avoidance.hpp"
+#include "service/locator.hpp"
+
+namespace Avoidance
+{
+	const float EPSILON = 0.00001f;
+
+	/**
+	 * Finds the point on the given line closest to the optimal velocity, that satisfies all previous lines
+	 * and lies within the speed circle
+	 */
+	bool linearProgram1(const std::vector<Line> &lines, size_t lineNo, float radius, const b2Vec2 &optVelocity,
+						bool directionOpt, b2Vec2 &result)
+	{
+		const Line &line = lines[lineNo];
+		float dotProduct = b2Dot(line.point, line.direction);
+		float discriminant = dotProduct * dotProduct + radius * radius - line.point.LengthSquared();
+
+		// speed circle fully invalidates this line
+		if (discriminant < 0.f)
+			return false;
+
+		float sqrtDiscriminant = sqrtf(discriminant);
+		float tLeft = -dotProduct - sqrtDiscriminant;
+		float tRight = -dotProduct + sqrtDiscriminant;
+
+		for (size_t i = 0; i < lineNo; ++i)
+		{
+			float denominator = b2Cross(line.direction, lines[i].direction);
+			float numerator = b2Cross(lines[i].direction, line.point - lines[i].point);
+
+			// parallel
+			if (fabsf(denominator) <= EPSILON)
+			{
+				if (numerator < 0.f)
+					return false;
+				continue;
+			}
+
+			float t = numerator / denominator;
+			if (denominator >= 0.f)
+				tRight = std::min(tRight, t);
+			else
+				tLeft = std::max(tLeft, t);
+
+			if (tLeft > tRight)
+				return false;
+		}
+
+		if (directionOpt)
+		{
+			// optimise direction
+			if (b2Dot(optVelocity, line.direction) > 0.f)
+				result = line.point + tRight * line.direction;
+			else
+				result = line.point + tLeft * line.direction;
+		}
+		else
+		{
+			// optimise closest point
+			float t = b2Dot(line.direction, optVelocity - line.point);
+			t = std::max(tLeft, std::min(tRight, t));
+			result = line.point + t * line.direction;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @return The number of lines satisfied before failing, which is all of them on success
+	 */
+	size_t linearProgram2(const std::vector<Line> &lines, float radius, const b2Vec2 &optVelocity,
+						  bool directionOpt, b2Vec2 &result)
+	{
+		if (directionOpt)
+			result = radius * optVelocity;
+		else if (optVelocity.LengthSquared() > radius * radius)
+		{
+			result = optVelocity;
+			result.Normalize();
+			result *= radius;
+		}
+		else
+			result = optVelocity;
+
+		for (size_t i = 0; i < lines.size(); ++i)
+		{
+			// result doesn't satisfy this constraint
+			if (b2Cross(lines[i].direction, lines[i].point - result) > 0.f)
+			{
+				b2Vec2 tempResult(result);
+				if (!linearProgram1(lines, i, radius, optVelocity, directionOpt, result))
+				{
+					result = tempResult;
+					return i;
+				}
+			}
+		}
+
+		return lines.size();
+	}
+
+	/**
+	 * Finds the velocity that minimises the maximum penetration into the unsatisfiable constraints
+	 */
+	void linearProgram3(const std::vector<Line> &lines, size_t beginLine, float radius, b2Vec2 &result,
+						std::vector<Line> &projectedLines)
+	{
+		float distance = 0.f;
+
+		for (size_t i = beginLine; i < lines.size(); ++i)
+		{
+			if (b2Cross(lines[i].direction, lines[i].point - result) <= distance)
+				continue;
+
+			projectedLines.clear();
+			for (size_t j = 0; j < i; ++j)
+			{
+				Line line;
+				float determinant = b2Cross(lines[i].direction, lines[j].direction);
+
+				if (fabsf(determinant) <= EPSILON)
+				{
+					// same direction
+					if (b2Dot(lines[i].direction, lines[j].direction) > 0.f)
+						continue;
+
+					// opposite direction
+					line.point = 0.5f * (lines[i].point + lines[j].point);
+				}
+				else
+				{
+					float t = b2Cross(lines[j].direction, lines[i].point - lines[j].point) / determinant;
+					line.point = lines[i].point + t * lines[i].direction;
+				}
+
+				line.direction = lines[j].direction - lines[i].direction;
+				line.direction.Normalize();
+				projectedLines.push_back(line);
+			}
+
+			b2Vec2 tempResult(result);
+			b2Vec2 optDirection(-lines[i].direction.y, lines[i].direction.x);
+			if (linearProgram2(projectedLines, radius, optDirection, true, result) < projectedLines.size())
+			{
+				// should not happen in principle, only due to floating point error
+				result = tempResult;
+			}
+
+			distance = b2Cross(lines[i].direction, lines[i].point - result);
+		}
+	}
+
+	b2Vec2 computeVelocity(const AvoidanceAgent &agent, const std::vector<const AvoidanceAgent *> &neighbours,
+						   float timeHorizon, float delta, Scratch &scratch)
+	{
+		std::vector<Line> &lines = scratch.lines;
+		lines.clear();
+
+		const float invTimeHorizon = 1.f / timeHorizon;
+
+		for (const AvoidanceAgent *other : neighbours)
+		{
+			b2Vec2 relativePosition = other->position - agent.position;
+			b2Vec2 relativeVelocity = agent.velocity - other->velocity;
+			float distSq = relativePosition.LengthSquared();
+			float combinedRadius = agent.radius + other->radius;
+			float combinedRadiusSq = combinedRadius * combinedRadius;
+
+			Line line;
+			b2Vec2 u;
+
+			if (distSq > combinedRadiusSq)
+			{
+				// vector from cutoff centre to relative velocity
+				b2Vec2 w = relativeVelocity - invTimeHorizon * relativePosition;
+				float wLengthSq = w.LengthSquared();
+				float dotProduct = b2Dot(w, relativePosition);
+
+				if (dotProduct < 0.f && dotProduct * dotProduct > combinedRadiusSq * wLengthSq)
+				{
+					// project on cutoff circle
+					float wLength = sqrtf(wLengthSq);
+					b2Vec2 unitW(w.x / wLength, w.y / wLength);
+
+					line.direction.Set(unitW.y, -unitW.x);
+					u = (combinedRadius * invTimeHorizon - wLength) * unitW;
+				}
+				else
+				{
+					// project on legs
+					float leg = sqrtf(distSq - combinedRadiusSq);
+
+					if (b2Cross(relativePosition, w) > 0.f)
+					{
+						// left leg
+						line.direction.Set(relativePosition.x * leg - relativePosition.y * combinedRadius,
+										   relativePosition.x * combinedRadius + relativePosition.y * leg);
+					}
+					else
+					{
+						// right leg
+						line.direction.Set(-(relativePosition.x * leg + relativePosition.y * combinedRadius),
+										   -(-relativePosition.x * combinedRadius + relativePosition.y * leg));
+					}
+					line.direction *= 1.f / distSq;
+
+					u = b2Dot(relativeVelocity, line.direction) * line.direction - relativeVelocity;
+				}
+			}
+			else
+			{
+				// already colliding, so resolve within this step
+				const float invDelta = 1.f / delta;
+
+				b2Vec2 w = relativeVelocity - invDelta * relativePosition;
+				float wLength = w.Length();
+				if (wLength <= EPSILON)
+					continue;
+
+				b2Vec2 unitW(w.x / wLength, w.y / wLength);
+
+				line.direction.Set(unitW.y, -unitW.x);
+				u = (combinedRadius * invDelta - wLength) * unitW;
+			}
+
+			// share the responsibility if the other agent is avoiding too
+			float share = other->responsive ? 0.5f : 1.f;
+			line.point = agent.velocity + share * u;
+			lines.push_back(line);
+		}
+
+		b2Vec2 result;
+		size_t lineFail = linearProgram2(lines, agent.maxSpeed, agent.preferredVelocity, false, result);
+		if (lineFail < lines.size())
+			linearProgram3(lines, lineFail, agent.maxSpeed, result, scratch.projectedLines);
+
+		return result;
+	}
+}
+
+AvoidanceSystem::AvoidanceSystem() : System(COMPONENT_PHYSICS | COMPONENT_INPUT),
+									 enabled(Config::getBool("ai.avoidance.enabled", true)),
+									 radius(Config::getFloat("ai.avoidance.radius", 0.45f)),
+									 neighbourDistance(Config::getFloat("ai.avoidance.neighbour-distance", 3.f)),
+									 maxNeighbours(static_cast<size_t>(Config::getInt("ai.avoidance.max-neighbours", 8))),
+									 timeHorizon(Config::getFloat("ai.avoidance.time-horizon", 1.5f)),
+									 playerEntity(INVALID_ENTITY),
+									 workers(static_cast<unsigned>(Config::getInt("ai.avoidance.threads", 0))),
+									 entityToAgent(MAX_ENTITIES, INVALID_ENTITY)
+{
+}
+
+void AvoidanceSystem::tick(EntityService *es, float dt)
+{
+	entities.clear();
+	agents.clear();
+
+	InputService *input = Locator::locate<InputService>(false);
+	playerEntity = input != nullptr && input->hasPlayerEntity() ? input->getPlayerEntity() : INVALID_ENTITY;
+
+	// gather agents
+	System::tick(es, dt);
+
+	if (enabled && dt > 0.f && agents.size() >= 2)
+		avoid(es, dt);
+
+	for (EntityID e : entities)
+		entityToAgent[e] = INVALID_ENTITY;
+}
+
+void AvoidanceSystem::avoid(EntityService *es, float dt)
+{
+	// neighbours are found through the grid from the last physics step, which isn't changed until after avoidance
+	const SpatialGrid &grid = es->getSpatialGrid();
+
+	// solve in parallel
+	newVelocities.resize(agents.size());
+	workers.parallelFor(agents.size(), [this, &grid, dt](size_t begin, size_t end)
+	{
+		solveRange(grid, begin, end, dt);
+	});
+
+	// steer towards the new velocity
+	for (size_t i = 0; i < agents.size(); ++i)
+	{
+		if (!agents[i].responsive)
+			continue;
+
+		auto *physics = es->getComponent<PhysicsComponent>(entities[i], COMPONENT_PHYSICS);
+		physics->steering = newVelocities[i] - agents[i].velocity;
+	}
+}
+
+void AvoidanceSystem::tickEntity(EntityService *es, EntityID e, float dt)
+{
+	auto *physics = es->getComponent<PhysicsComponent>(e, COMPONENT_PHYSICS);
+
+	// steer as the brain wants unless avoided below, as brains skipped by lod don't rewrite their steering
+	physics->steering = physics->desiredSteering;
+	if (!enabled || dt <= 0.f)
+		return;
+
+	AvoidanceAgent agent;
+	agent.position = physics->body->GetPosition();
+	agent.velocity = physics->body->GetLinearVelocity();
+	agent.radius = radius;
+	agent.maxSpeed = physics->maxSpeed;
+
+	// where it would go without avoidance
+	agent.preferredVelocity = agent.velocity + physics->desiredSteering;
+	float speed = agent.preferredVelocity.Length();
+	if (speed > agent.maxSpeed)
+		agent.preferredVelocity *= agent.maxSpeed / speed;
+
+	// the player and idle agents stand their ground
+	agent.responsive = physics->isSteering() && e != playerEntity;
+
+	entityToAgent[e] = static_cast<EntityID>(agents.size());
+	entities.push_back(e);
+	agents.push_back(agent);
+}
+
+void AvoidanceSystem::solveRange(const SpatialGrid &grid, size_t begin, size_t end, float dt)
+{
+	Avoidance::Scratch scratch;
+	std::vector<EntityID> nearby;
+	std::vector<const AvoidanceAgent *> neighbours;
+
+	const float rangeSq = neighbourDistance * neighbourDistance;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (!agents[i].responsive)
+			continue;
+
+		const AvoidanceAgent &agent = agents[i];
+
+		// find neighbours
+		nearby.clear();
+		sf::FloatRect area(agent.position.x - neighbourDistance, agent.position.y - neighbourDistance,
+						   neighbourDistance * 2, neighbourDistance * 2);
+		grid.query(area, nearby);
+
+		scratch.neighbours.clear();
+		for (EntityID other : nearby)
+		{
+			EntityID index = entityToAgent[other];
+			if (index == INVALID_ENTITY || static_cast<size_t>(index) == i)
+				continue;
+
+			const AvoidanceAgent *otherAgent = &agents[index];
+			float distSq = (otherAgent->position - agent.position).LengthSquared();
+			if (distSq < rangeSq)
+				scratch.neighbours.push_back({distSq, otherAgent});
+		}
+
+		// closest only
+		if (scratch.neighbours.size() > maxNeighbours)
+		{
+			std::nth_element(scratch.neighbours.begin(), scratch.neighbours.begin() + maxNeighbours,
+							 scratch.neighbours.end(),
+							 [](const std::pair<float, const AvoidanceAgent *> &a,
+								const std::pair<float, const AvoidanceAgent *> &b)
+							 {
+								 return a.first < b.first;
+							 });
+			scratch.neighbours.resize(maxNeighbours);
+		}
+
+		neighbours.clear();
+		for (auto &pair : scratch.neighbours)
+			neighbours.push_back(pair.second);
+
+		newVelocities[i] = neighbours.empty()
+						   ? agent.preferredVelocity
+						   : Avoidance::computeVelocity(agent, neighbours, timeHorizon, dt, scratch);
+	}
+}
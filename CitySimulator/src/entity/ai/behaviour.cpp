@@ -0,0 +1,215 @@
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/exception/diagnostic_information.hpp>
+#include "behaviour.hpp"
+#include "utils.hpp"
+#include "service/locator.hpp"
+
+BehaviourNodeType Behaviour::parseType(const std::string &s)
+{
+	if (s == "sequence")
+		return BEHAVIOUR_SEQUENCE;
+	if (s == "selector")
+		return BEHAVIOUR_SELECTOR;
+	if (s == "chance")
+		return BEHAVIOUR_CHANCE;
+	if (s == "time-between")
+		return BEHAVIOUR_TIME_BETWEEN;
+	if (s == "wander")
+		return BEHAVIOUR_WANDER;
+	if (s == "wait")
+		return BEHAVIOUR_WAIT;
+	if (s == "sleep-until")
+		return BEHAVIOUR_SLEEP_UNTIL;
+
+	return BEHAVIOUR_UNKNOWN;
+}
+
+bool Behaviour::isAction(BehaviourNodeType type)
+{
+	return type == BEHAVIOUR_WANDER || type == BEHAVIOUR_WAIT || type == BEHAVIOUR_SLEEP_UNTIL;
+}
+
+void Behaviour::loadTrees(const std::string &path, BehaviourTrees &out)
+{
+	if (!boost::filesystem::exists(path))
+		throw Utils::filenotfound_exception(format("Behaviour file not found: '%1%'", path));
+
+	boost::property_tree::ptree root;
+	try
+	{
+		read_json(path, root);
+	} catch (boost::exception &e)
+	{
+		error("Could not load behaviours from '%1%': %2%", path, boost::current_exception_diagnostic_information());
+	}
+
+	for (auto &tree : root)
+	{
+		out[tree.first].load(tree.second);
+		Logger::logDebuggier(format("Loaded behaviour '%1%' with %2% nodes", tree.first,
+									_str(out[tree.first].getNodeCount())));
+	}
+}
+
+void BehaviourTree::load(const boost::property_tree::ptree &root)
+{
+	nodes.clear();
+	flatten(root, 0);
+}
+
+void BehaviourTree::flatten(const boost::property_tree::ptree &node, unsigned depth)
+{
+	if (nodes.size() >= INVALID_BEHAVIOUR_NODE)
+		error("Behaviour tree is too large");
+
+	std::string typeName(node.get<std::string>("type", ""));
+	BehaviourNodeType type = Behaviour::parseType(typeName);
+	if (type == BEHAVIOUR_UNKNOWN)
+		error("Unknown behaviour type '%1%'", typeName);
+
+	BehaviourNode flat;
+	flat.type = type;
+	flat.params[0] = flat.params[1] = 0.f;
+
+	switch (type)
+	{
+		case BEHAVIOUR_CHANCE:
+			flat.params[0] = node.get("probability", 0.5f);
+			break;
+
+		case BEHAVIOUR_WANDER:
+			flat.params[0] = node.get("radius", 5.f);
+			flat.params[1] = node.get("timeout", 10.f);
+			break;
+
+		case BEHAVIOUR_WAIT:
+			flat.params[0] = node.get("min", 1.f);
+			flat.params[1] = node.get("max", flat.params[0]);
+			break;
+
+		case BEHAVIOUR_TIME_BETWEEN:
+			flat.params[0] = node.get("from", 0.f);
+			flat.params[1] = node.get("to", 24.f);
+			break;
+
+		case BEHAVIOUR_SLEEP_UNTIL:
+			flat.params[0] = node.get("hour", 8.f);
+			break;
+
+		default:
+			break;
+	}
+
+	size_t index = nodes.size();
+	nodes.push_back(flat);
+
+	// children directly follow their parent
+	auto children = node.get_child_optional("children");
+	if (children)
+	{
+		if (type != BEHAVIOUR_SEQUENCE && type != BEHAVIOUR_SELECTOR)
+			error("Behaviour '%1%' cannot have children", typeName);
+		if (depth >= MAX_BEHAVIOUR_DEPTH)
+			error("Behaviour tree is nested deeper than %1% composites", _str(MAX_BEHAVIOUR_DEPTH));
+
+		for (auto &child : *children)
+			flatten(child.second, depth + 1);
+	}
+
+	nodes[index].end = static_cast<BehaviourNodeIndex>(nodes.size());
+}
+
+BehaviourNodeIndex BehaviourTree::think(Blackboard &blackboard) const
+{
+	BehaviourNodeIndex chosen = INVALID_BEHAVIOUR_NODE;
+	if (!nodes.empty())
+	{
+		evaluate(0, 0, blackboard, chosen);
+
+		// the whole tree has finished, so start it again
+		if (chosen == INVALID_BEHAVIOUR_NODE)
+			evaluate(0, 0, blackboard, chosen);
+	}
+
+	blackboard.action = chosen;
+	blackboard.status = chosen == INVALID_BEHAVIOUR_NODE ? STATUS_SUCCESS : STATUS_RUNNING;
+	return chosen;
+}
+
+const BehaviourNode &BehaviourTree::getNode(BehaviourNodeIndex index) const
+{
+	return nodes[index];
+}
+
+BehaviourStatus BehaviourTree::evaluate(BehaviourNodeIndex index, unsigned depth, Blackboard &blackboard,
+										BehaviourNodeIndex &chosen) const
+{
+	const BehaviourNode &node = nodes[index];
+
+	switch (node.type)
+	{
+		case BEHAVIOUR_SEQUENCE:
+		case BEHAVIOUR_SELECTOR:
+		{
+			// sequences stop at the first child that doesn't succeed, selectors at the first that doesn't fail
+			BehaviourStatus carryOn = node.type == BEHAVIOUR_SEQUENCE ? STATUS_SUCCESS : STATUS_FAILURE;
+
+			// carry on from the running child, so earlier children aren't repeated
+			BehaviourNodeIndex &running = blackboard.running[depth];
+			BehaviourNodeIndex child = running > index && running < node.end ? running : index + 1;
+
+			for (; child < node.end; child = nodes[child].end)
+			{
+				BehaviourStatus status = evaluate(child, depth + 1, blackboard, chosen);
+				if (status == STATUS_RUNNING)
+				{
+					running = child;
+					return status;
+				}
+
+				if (status != carryOn)
+				{
+					running = INVALID_BEHAVIOUR_NODE;
+					return status;
+				}
+			}
+
+			running = INVALID_BEHAVIOUR_NODE;
+			return carryOn;
+		}
+
+		case BEHAVIOUR_CHANCE:
+			return Utils::random(0.f, 1.f) < node.params[0] ? STATUS_SUCCESS : STATUS_FAILURE;
+
+		case BEHAVIOUR_TIME_BETWEEN:
+		{
+			ClockService *clock = Locator::locate<ClockService>(false);
+			if (clock == nullptr)
+				return STATUS_FAILURE;
+
+			float hour = clock->getHourOfDay();
+			float from = node.params[0];
+			float to = node.params[1];
+
+			// wraps around midnight
+			bool between = from <= to ? hour >= from && hour < to : hour >= from || hour < to;
+			return between ? STATUS_SUCCESS : STATUS_FAILURE;
+		}
+
+		default:
+		{
+			// the action that just finished
+			if (index == blackboard.action && blackboard.status != STATUS_RUNNING)
+			{
+				BehaviourStatus status = blackboard.status;
+				blackboard.action = INVALID_BEHAVIOUR_NODE;
+				return status;
+			}
+
+			// start this action, or carry on if it's still running
+			chosen = index;
+			return STATUS_RUNNING;
+		}
+	}
+}
@@ -1,15 +1,21 @@
 #include <SFML/Graphics.hpp>
 #include <regex>
-#include "PackingTreeNode.h"
+#include "atlas_packer.hpp"
 #include "animation.hpp"
+#include "sprite_batch.hpp"
 #include "service/animation_service.hpp"
 #include "service/config_service.hpp"
 #include "service/logging_service.hpp"
+#include "serialization.hpp"
+#include "workers.hpp"
+
+const std::string spriteCacheMagic("CSSPRITES");
+const uint32_t spriteCacheVersion = 2;
 
 void AnimationService::onEnable()
 {
-	preProcessImageData = new std::map<sf::Image *, std::pair<ConfigKeyValue, EntityType>>;
 	processed = false;
+	fromCache = false;
 }
 
 Animation *AnimationService::getAnimation(EntityType entityType, const std::string &name)
@@ -44,22 +50,15 @@ void AnimationService::loadSprite(ConfigKeyValue &entityTags, EntityType entityT
 	checkProcessed(false);
 
 	std::string fileName(entityTags["sprite"]);
+	std::string path(Utils::searchForFile(fileName, Config::getResource("entities.sprites")));
 
-	sf::Image *image = new sf::Image;
-	if (!image->loadFromFile(Utils::searchForFile(fileName, Config::getResource("entities.sprites"))))
-		error("Could not load sprite %1%", fileName);
-
-	preProcessImageData->insert({image, {entityTags, entityType}});
-	Logger::logDebuggier(format("Loaded sprite %1%", entityTags["name"]));
+	queuedSprites.emplace_back(path, entityTags, entityType);
+	Logger::logDebuggier(format("Queued sprite %1%", entityTags["name"]));
 }
 
 void AnimationService::loadGUI()
 {
 	// todo load all animations from a gui.json
-	sf::Image *image = new sf::Image;
-	if (!image->loadFromFile(Config::getResource("gui.controller-arrow")))
-		error("Could not load controller arrow image! Serves you right for being so hacky");
-
 	// lord forgive me
 	ConfigKeyValue tags;
 	tags["name"] = "Controller Arrow";
@@ -67,8 +66,8 @@ void AnimationService::loadGUI()
 	tags["anim-length"] = "1";
 	tags["anim-dimensions-all"] = "16x8";
 
-	preProcessImageData->insert({image, {tags, ENTITY_UNKNOWN}});
-	Logger::logDebuggier("Loaded controller arrow");
+	queuedSprites.emplace_back(Config::getResource("gui.controller-arrow"), tags, ENTITY_UNKNOWN);
+	Logger::logDebuggier("Queued controller arrow");
 }
 
 
@@ -95,109 +94,92 @@ sf::Vector2i AnimationService::stringToVector(const std::string &s)
 	return sf::Vector2i(x, y);
 }
 
-void AnimationService::positionImages(sf::Vector2i &imageSize, std::map<sf::Image *, sf::IntRect> &imagePositions)
+void AnimationService::positionImages(std::vector<sf::Vector2u> &pageSizes,
+									  std::vector<AtlasPacker::Placement> &placements)
 {
-// calculate initial size of bin
-	sf::Vector2u totalSize = std::accumulate(preProcessImageData->begin(), preProcessImageData->end(), sf::Vector2u(),
-											 [](sf::Vector2u &acc,
-												const std::pair<sf::Image *, std::pair<ConfigKeyValue, EntityType>> &pair)
-											 {
-												 return acc + pair.first->getSize();
-											 });
-
-	sf::IntRect binRect(0, 0, totalSize.x, totalSize.y);
-	PackingTreeNode node(binRect);
-
-	// sort by area (insert into a vector first)
-	std::vector<std::pair<sf::Image *, std::pair<ConfigKeyValue, EntityType>>> asVector;
-	for (auto it(preProcessImageData->cbegin()); it != preProcessImageData->cend(); ++it)
-		asVector.push_back(*it);
-
-	std::sort(asVector.begin(), asVector.end(),
-			  [](const std::pair<sf::Image *, std::pair<ConfigKeyValue, EntityType>> &left,
-				 const std::pair<sf::Image *, std::pair<ConfigKeyValue, EntityType>> &right)
-			  {
-				  sf::Vector2i leftSize(left.first->getSize());
-				  sf::Vector2i rightSize(right.first->getSize());
-
-				  return (leftSize.x * leftSize.y) < (rightSize.x * rightSize.y);
-			  });
-
-	// insert one at a time
-	for (auto &pair : asVector)
-	{
-		sf::Vector2u size = pair.first->getSize();
-		sf::IntRect rect(0, 0, static_cast<int>(size.x), static_cast<int>(size.y));
+	std::vector<sf::Vector2u> sizes;
+	for (const QueuedSprite &sprite : queuedSprites)
+		sizes.push_back(sprite.image.getSize());
 
-		auto positionedRect = node.insert(rect);
+	AtlasPacker packer(sf::Texture::getMaximumSize());
+	if (!packer.pack(sizes))
+		error("Could not pack a sprite larger than the maximum texture size of %1%",
+			  _str(sf::Texture::getMaximumSize()));
 
-		if (!positionedRect)
-			error("Could not pack spritesheet of size %1%, %2%", _str(size.x), _str(size.y));
+	placements = packer.getPlacements();
+	pageSizes = packer.getPageSizes();
 
-		imagePositions.insert({pair.first, *positionedRect});
-	}
-
-	// find min bounding box
-	int minX(0);
-	int minY(0);
-
-	int x, y;
-	for (auto &pair : imagePositions)
-	{
-		sf::IntRect &rect(pair.second);
-		x = rect.left + rect.width;
-		if (x > minX)
-			minX = x;
-
-		y = rect.top + rect.height;
-		if (y > minY)
-			minY = y;
-	}
-
-	imageSize.x = minX;
-	imageSize.y = minY;
+	Logger::logDebug(format("Packed %1% sprites into %2% page(s) with %3% efficiency", _str(sizes.size()),
+							_str(pageSizes.size()), _str(static_cast<int>(packer.getEfficiency() * 100)) + "%"));
 }
 
 void AnimationService::processQueuedSprites()
 {
 	// no images
-	if (preProcessImageData->empty())
+	if (queuedSprites.empty())
 	{
 		Logger::logWarning("No sprites were queued for loading by loadSprite");
 		return;
 	}
 
+	// reuse last run's spritesheet if nothing has changed
+	std::string cachePath(Utils::joinPaths(Config::getResource("entities.root"), "sprites.cache"));
+	uint64_t cacheKey;
+	bool useCache = Config::getBool("entities.sprite-cache", true) && hashQueuedSprites(cacheKey);
+
+	if (useCache && loadCache(cachePath, cacheKey))
+	{
+		Logger::logDebug(format("Loaded %1% sprites from %2%", _str(queuedSprites.size()), cachePath));
+		fromCache = true;
+		queuedSprites.clear();
+		processed = true;
+		return;
+	}
+
+	// decode on every core, as each image is independent
+	WorkerPool workers;
+	workers.parallelFor(queuedSprites.size(), [this](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (!queuedSprites[i].image.loadFromFile(queuedSprites[i].path))
+				error("Could not load sprite %1%", queuedSprites[i].path);
+		}
+	}, 1);
+
 	// position
-	sf::Vector2i finalImageSize;
-	std::map<sf::Image *, sf::IntRect> imageRects;
-	positionImages(finalImageSize, imageRects);
+	std::vector<sf::Vector2u> pageSizes;
+	std::vector<AtlasPacker::Placement> placements;
+	positionImages(pageSizes, placements);
 
-	// create image
-	sf::Image finalImage;
-	finalImage.create(finalImageSize.x, finalImageSize.y, sf::Color::Transparent);
+	// create pages
+	std::vector<sf::Image> pages(pageSizes.size());
+	for (size_t i = 0; i < pages.size(); ++i)
+		pages[i].create(pageSizes[i].x, pageSizes[i].y, sf::Color::Transparent);
 
-	// copy individual images to spritesheet
-	for (auto &pair : imageRects)
+	// copy individual images to spritesheets
+	for (size_t i = 0; i < queuedSprites.size(); ++i)
 	{
-		finalImage.copy(*pair.first, pair.second.left, pair.second.top);
-		delete pair.first;
+		const AtlasPacker::Placement &placement = placements[i];
+		pages[placement.page].copy(queuedSprites[i].image, placement.rect.left, placement.rect.top);
 	}
 
-	// convert to texture
-	if (!texture.loadFromImage(finalImage))
-		throw std::runtime_error("Could not convert spritesheets to a texture");
+	// convert to textures
+	textures.assign(pages.size(), sf::Texture());
+	for (size_t i = 0; i < pages.size(); ++i)
+	{
+		if (!textures[i].loadFromImage(pages[i]))
+			throw std::runtime_error("Could not convert spritesheets to a texture");
+	}
 
 	// create animations
-	for (auto &rectPair : imageRects)
+	for (size_t i = 0; i < queuedSprites.size(); ++i)
 	{
-		Animation anim(&texture);
-
-		sf::Image *image(rectPair.first);
-		sf::IntRect &rect(rectPair.second);
+		Animation anim(&textures[placements[i].page]);
 
-		auto pair = preProcessImageData->at(image);
-		ConfigKeyValue entityTags = pair.first;
-		EntityType entityType = pair.second;
+		sf::IntRect &rect(placements[i].rect);
+		ConfigKeyValue &entityTags = queuedSprites[i].tags;
+		EntityType entityType = queuedSprites[i].entityType;
 
 		int animCount, animLength;
 
@@ -234,37 +216,193 @@ void AnimationService::processQueuedSprites()
 		}
 
 		// store in animation map under the entity type
-		std::pair<std::string, Animation> animationPair = {entityTags["name"], anim};
+		animations[entityType].insert({entityTags["name"], anim});
+	}
 
-		auto existingAnims = animations.find(entityType);
-		if (existingAnims != animations.end())
-			existingAnims->second.insert(animationPair);
-		else
+	if (useCache)
+		saveCache(cachePath, cacheKey, pages);
+
+	queuedSprites.clear();
+	processed = true;
+}
+
+bool AnimationService::hashQueuedSprites(uint64_t &out)
+{
+	// entity definitions, then each sprite's tags and pixels in the order they were queued
+	if (!Serialization::hashFile(Config::getResource("entities.config"), out))
+		return false;
+
+	for (const QueuedSprite &sprite : queuedSprites)
+	{
+		out = Serialization::hash(&sprite.entityType, sizeof(sprite.entityType), out);
+
+		for (const auto &tag : sprite.tags)
 		{
-			std::unordered_map<std::string, Animation> anims;
-			anims.insert(animationPair);
-			animations.insert({entityType, anims});
+			out = Serialization::hash(tag.first.data(), tag.first.size() + 1, out);
+			out = Serialization::hash(tag.second.data(), tag.second.size() + 1, out);
 		}
+
+		if (!Serialization::hashFile(sprite.path, out, out))
+			return false;
 	}
 
-	preProcessImageData->clear();
-	delete preProcessImageData;
+	return true;
+}
 
-	processed = true;
+bool AnimationService::loadCache(const std::string &path, uint64_t key)
+{
+	BinaryReader reader(path);
+	if (!reader.readHeader(spriteCacheMagic, spriteCacheVersion))
+		return false;
+
+	std::vector<sf::Image> pages;
+	std::vector<sf::Texture> loadedTextures;
+	std::map<EntityType, std::unordered_map<std::string, Animation>> loaded;
+
+	try
+	{
+		if (reader.read<uint64_t>() != key)
+			return false;
+
+		pages.resize(reader.read<uint32_t>());
+		loadedTextures.resize(pages.size());
+
+		std::vector<sf::Uint8> pixels;
+		for (sf::Image &page : pages)
+		{
+			sf::Vector2u pixelSize = reader.read<sf::Vector2u>();
+			reader.readVector(pixels);
+
+			if (pixels.size() != pixelSize.x * pixelSize.y * 4)
+				error("Expected %1% bytes of pixels, but got %2%", _str(pixelSize.x * pixelSize.y * 4),
+					  _str(pixels.size()));
+
+			page.create(pixelSize.x, pixelSize.y, pixels.data());
+		}
+
+		uint32_t animationCount = reader.read<uint32_t>();
+		for (uint32_t i = 0; i < animationCount; ++i)
+		{
+			EntityType entityType = static_cast<EntityType>(reader.read<int32_t>());
+			std::string name(reader.readString());
+
+			uint32_t page = reader.read<uint32_t>();
+			if (page >= pages.size())
+				error("Animation %1% is on page %2% of %3%", name, _str(page), _str(pages.size()));
+
+			// swapping keeps the textures at the same address
+			Animation anim(&loadedTextures[page]);
+			uint32_t sequenceCount = reader.read<uint32_t>();
+
+			std::vector<sf::IntRect> rects;
+			for (uint32_t seq = 0; seq < sequenceCount; ++seq)
+			{
+				reader.readVector(rects);
+				anim.addSequence(rects);
+			}
+
+			loaded[entityType].insert({name, anim});
+		}
+	} catch (std::runtime_error &e)
+	{
+		Logger::logWarning(format("Invalid sprite cache: %1%", e.what()));
+		return false;
+	}
+
+	for (size_t i = 0; i < pages.size(); ++i)
+	{
+		if (!loadedTextures[i].loadFromImage(pages[i]))
+			return false;
+	}
+
+	textures.swap(loadedTextures);
+	animations.swap(loaded);
+	return true;
+}
+
+void AnimationService::saveCache(const std::string &path, uint64_t key, const std::vector<sf::Image> &pages)
+{
+	uint32_t animationCount = 0;
+	for (const auto &typeAnimations : animations)
+		animationCount += static_cast<uint32_t>(typeAnimations.second.size());
+
+	BinaryWriter writer(path);
+	writer.writeHeader(spriteCacheMagic, spriteCacheVersion);
+	writer.write(key);
+
+	writer.write(static_cast<uint32_t>(pages.size()));
+	for (const sf::Image &page : pages)
+	{
+		sf::Vector2u pixelSize(page.getSize());
+		const sf::Uint8 *pixelsPtr = page.getPixelsPtr();
+
+		writer.write(pixelSize);
+		writer.writeVector(std::vector<sf::Uint8>(pixelsPtr, pixelsPtr + pixelSize.x * pixelSize.y * 4));
+	}
+
+	writer.write(animationCount);
+	for (const auto &typeAnimations : animations)
+	{
+		for (const auto &pair : typeAnimations.second)
+		{
+			writer.write(static_cast<int32_t>(typeAnimations.first));
+			writer.writeString(pair.first);
+			writer.write(static_cast<uint32_t>(pair.second.texture - &textures[0]));
+
+			const Animation &anim = pair.second;
+			writer.write(static_cast<uint32_t>(anim.sequences.size()));
+
+			std::vector<sf::IntRect> rects;
+			for (const Animation::Sequence &sequence : anim.sequences)
+			{
+				rects.clear();
+				for (unsigned frame = 0; frame < sequence.length; ++frame)
+					rects.push_back(anim.frames[sequence.first + frame].rect);
+
+				writer.writeVector(rects);
+			}
+		}
+	}
+
+	if (!writer.good())
+		Logger::logWarning(format("Could not write sprite cache to %1%", path));
 }
 
 Animation *Animation::addRow(const sf::Vector2i &startPosition, const sf::Vector2i &spriteDimensions, int rowLength)
 {
-	Sequence seq;
+	std::vector<sf::IntRect> rects;
 
 	sf::IntRect rect(startPosition, spriteDimensions);
 	for (int i = 0; i < rowLength; i++)
 	{
-		seq.push_back(rect);
+		rects.push_back(rect);
 		rect.left += spriteDimensions.x;
 	}
 
-	sequences.push_back(seq);
+	return addSequence(rects);
+}
+
+Animation *Animation::addSequence(const std::vector<sf::IntRect> &rects)
+{
+	Sequence sequence;
+	sequence.first = static_cast<unsigned>(frames.size());
+	sequence.length = static_cast<unsigned>(rects.size());
+	sequences.push_back(sequence);
+
+	for (const sf::IntRect &rect : rects)
+	{
+		Frame frame;
+		frame.rect = rect;
+
+		sf::FloatRect r(rect);
+		frame.quad[0] = sf::Vertex(sf::Vector2f(0, 0), sf::Vector2f(r.left, r.top));
+		frame.quad[1] = sf::Vertex(sf::Vector2f(r.width, 0), sf::Vector2f(r.left + r.width, r.top));
+		frame.quad[2] = sf::Vertex(sf::Vector2f(r.width, r.height), sf::Vector2f(r.left + r.width, r.top + r.height));
+		frame.quad[3] = sf::Vertex(sf::Vector2f(0, r.height), sf::Vector2f(r.left, r.top + r.height));
+
+		frames.push_back(frame);
+	}
+
 	return this;
 }
 
@@ -282,8 +420,9 @@ void Animator::init(Animation *anim, float step, DirectionType initialDirection,
 	playing = initiallyPlaying;
 	direction = initialDirection;
 
-	vertices.setPrimitiveType(sf::Quads);
-	vertices.resize(4);
+	this->step = step;
+	phase = 0.f;
+	restartPhase = true;
 
 	if (anim != nullptr)
 	{
@@ -300,11 +439,25 @@ void Animator::tick(float delta)
 	// next frame
 	if (ticker.tick(delta))
 	{
-		if (++currentFrame >= animation->sequences.size())
+		if (++currentFrame >= animation->sequences[currentSequence].length)
 			currentFrame = 0;
+	}
+}
+
+void Animator::evaluate(float clock)
+{
+	if (!playing || step <= 0.f)
+		return;
 
-		updateFrame();
+	// pick up where it left off
+	if (restartPhase)
+	{
+		phase = clock - currentFrame * step;
+		restartPhase = false;
 	}
+
+	unsigned length = animation->sequences[currentSequence].length;
+	currentFrame = static_cast<unsigned>((clock - phase) / step) % length;
 }
 
 void Animator::turn(DirectionType direction, bool reset)
@@ -324,20 +477,28 @@ void Animator::turn(DirectionType direction, bool reset)
 	else if (direction == DIRECTION_SOUTH)
 		currentSequence = 0;
 
-	if (reset)
-		currentFrame = 0;
+	// animations with fewer directions face south
+	if (currentSequence >= animation->sequences.size())
+		currentSequence = 0;
 
-	updateFrame();
+	if (reset || currentFrame >= animation->sequences[currentSequence].length)
+	{
+		currentFrame = 0;
+		restartPhase = true;
+	}
 }
 
 void Animator::setPlaying(bool playing, bool reset)
 {
+	if (playing != this->playing)
+		restartPhase = true;
+
 	this->playing = playing;
 
 	if (reset)
 	{
 		currentFrame = 0;
-		updateFrame();
+		restartPhase = true;
 	}
 }
 
@@ -346,35 +507,14 @@ void Animator::togglePlaying(bool resetEachTime)
 	setPlaying(!playing, resetEachTime);
 }
 
-void Animator::resizeVertices(float width, float height)
-{
-	if (width == currentSize.x && height == currentSize.y)
-		return;
-
-	vertices[0].position = sf::Vector2f(0, 0);
-	vertices[1].position = sf::Vector2f(width, 0);
-	vertices[2].position = sf::Vector2f(width, height);
-	vertices[3].position = sf::Vector2f(0, height);
-
-	currentSize.x = width;
-	currentSize.y = height;
-}
-
-void Animator::updateFrame()
+void Animator::draw(sf::RenderTarget &target, sf::RenderStates states) const
 {
-	Animation::Sequence sequence(animation->sequences[currentSequence]);
-	sf::FloatRect rect(sequence[currentFrame]);
-
-	resizeVertices(rect.width, rect.height);
-
-	vertices[0].texCoords = sf::Vector2f(rect.left, rect.top);
-	vertices[1].texCoords = sf::Vector2f(rect.left + rect.width, rect.top);
-	vertices[2].texCoords = sf::Vector2f(rect.left + rect.width, rect.top + rect.height);
-	vertices[3].texCoords = sf::Vector2f(rect.left, rect.top + rect.height);
+	states.texture = animation->texture;
+	target.draw(animation->getFrame(currentSequence, currentFrame).quad, 4, sf::Quads, states);
 }
 
-void Animator::draw(sf::RenderTarget &target, sf::RenderStates states) const
+void Animator::draw(SpriteBatch &batch, sf::RenderStates states) const
 {
 	states.texture = animation->texture;
-	target.draw(vertices, states);
+	batch.add(animation->getFrame(currentSequence, currentFrame).quad, states);
 }
@@ -1,7 +1,10 @@
+#include <algorithm>
+#include <chrono>
 #include "ecs.hpp"
 #include "ai.hpp"
 #include "service/entity_service.hpp"
 #include "service/config_service.hpp"
+#include "service/locator.hpp"
 
 void System::tick(EntityService *es, float dt)
 {
@@ -12,16 +15,22 @@ void System::tick(EntityService *es, float dt)
 	}
 }
 
-void System::render(EntityService *es, sf::RenderWindow &window)
+void System::render(EntityService *es, sf::RenderTarget &target)
 {
 	for (EntityID e = 0; e < MAX_ENTITIES; ++e)
 	{
 		if ((es->getComponentMask(e) & mask) == mask)
-			renderEntity(es, e, window);
+			renderEntity(es, e, target);
 	}
 }
 
 void RenderSystem::tickEntity(EntityService *es, EntityID e, float dt)
+{
+	// advance animation frame
+	updateAnimation(es, e).tick(dt);
+}
+
+Animator &RenderSystem::updateAnimation(EntityService *es, EntityID e)
 {
 	auto *render = es->getComponent<RenderComponent>(e, COMPONENT_RENDER);
 	auto *physics = es->getComponent<PhysicsComponent>(e, COMPONENT_PHYSICS);
@@ -38,18 +47,147 @@ void RenderSystem::tickEntity(EntityService *es, EntityID e, float dt)
 	DirectionType direction = Direction::fromAngle(angleDeg);
 	render->anim.turn(direction, false);
 
-	// advance animation frame
-	render->anim.tick(dt);
+	return render->anim;
+}
+
+InputSystem::InputSystem() : System(COMPONENT_INPUT), thinkCursor(0), frame(0), accumulatedDelta(MAX_ENTITIES, 0.f),
+							 clock(nullptr), cameraWorld(nullptr)
+{
+	thinkBudget = Config::getInt("ai.behaviour.budget-us", 500);
+
+	lodEnabled = Config::getBool("ai.lod.enabled", true);
+	nearMargin = Config::getFloat("ai.lod.near-margin", 4.f) * Constants::tileSizef;
+	midMargin = Config::getFloat("ai.lod.mid-margin", 32.f) * Constants::tileSizef;
+	midInterval = std::max(1, Config::getInt("ai.lod.mid-interval", 15));
+	farInterval = std::max(1, Config::getInt("ai.lod.far-interval", 60));
+	idleMultiplier = std::max(1, Config::getInt("ai.lod.idle-multiplier", 2));
+}
+
+void InputSystem::tick(EntityService *es, float dt)
+{
+	// find the area around the camera
+	CameraService *camera = Locator::locate<CameraService>(false);
+	if (camera != nullptr)
+	{
+		const sf::View &view = camera->getView();
+		sf::Vector2f corner(view.getCenter() - view.getSize() / 2.f);
+
+		nearArea = sf::FloatRect(corner.x - nearMargin, corner.y - nearMargin,
+								 view.getSize().x + nearMargin * 2, view.getSize().y + nearMargin * 2);
+		midArea = sf::FloatRect(corner.x - midMargin, corner.y - midMargin,
+								view.getSize().x + midMargin * 2, view.getSize().y + midMargin * 2);
+		cameraWorld = camera->getWorld()->getBox2DWorld();
+	}
+	else
+		cameraWorld = nullptr;
+
+	clock = Locator::locate<ClockService>(false);
+	findAwake(es);
+
+	// carry out current actions
+	for (EntityID e : awake)
+		tickEntity(es, e, dt);
+	++frame;
+
+	// think in turns, carrying on from where the last frame ran out of time
+	auto start = std::chrono::steady_clock::now();
+	auto budget = std::chrono::microseconds(thinkBudget);
+
+	for (size_t i = 0; i < awake.size(); ++i)
+	{
+		EntityID e = awake[thinkCursor++ % awake.size()];
+
+		Brain *brain = es->getComponent<InputComponent>(e, COMPONENT_INPUT)->brain.get();
+		if (!brain->wantsToThink())
+			continue;
+
+		brain->think();
+
+		// starts afresh when woken
+		if (clock != nullptr && clock->isSleeping(e))
+			accumulatedDelta[e] = 0.f;
+
+		if (std::chrono::steady_clock::now() - start >= budget)
+			break;
+	}
+}
+
+void InputSystem::findAwake(EntityService *es)
+{
+	awake.clear();
+
+	// sleeping brains are left alone until the clock wakes them
+	if (clock != nullptr)
+	{
+		for (EntityID e : clock->getAwakeEntities())
+		{
+			if ((es->getComponentMask(e) & mask) == mask)
+				awake.push_back(e);
+		}
+		return;
+	}
+
+	for (EntityID e = 0; e < MAX_ENTITIES; ++e)
+	{
+		if ((es->getComponentMask(e) & mask) == mask)
+			awake.push_back(e);
+	}
 }
 
 void InputSystem::tickEntity(EntityService *es, EntityID e, float dt)
 {
-	es->getComponent<InputComponent>(e, COMPONENT_INPUT)->brain->tick(dt);
+	Brain *brain = es->getComponent<InputComponent>(e, COMPONENT_INPUT)->brain.get();
+	auto *physics = es->getComponent<PhysicsComponent>(e, COMPONENT_PHYSICS);
+
+	accumulatedDelta[e] += dt;
+
+	// offset by entity to spread ticks evenly across frames
+	unsigned interval = getTickInterval(brain, physics);
+	if ((frame + e) % interval != 0)
+		return;
+
+	brain->tick(accumulatedDelta[e]);
+	accumulatedDelta[e] = 0.f;
+}
+
+unsigned InputSystem::getTickInterval(Brain *brain, PhysicsComponent *physics) const
+{
+	if (!lodEnabled || cameraWorld == nullptr || brain->isImportant())
+		return 1;
+
+	unsigned interval;
+	sf::Vector2f pos(physics->getPosition());
+
+	if (physics->bWorld != cameraWorld)
+		interval = farInterval;
+	else if (nearArea.contains(pos))
+		return 1;
+	else if (midArea.contains(pos))
+		interval = midInterval;
+	else
+		interval = farInterval;
+
+	if (brain->isIdle())
+		interval = std::min(interval * idleMultiplier, farInterval);
+
+	return interval;
+}
+
+void PhysicsSystem::tick(EntityService *es, float dt)
+{
+	SpatialGrid &grid = es->getSpatialGrid();
+	grid.clear();
+
+	System::tick(es, dt);
+
+	// positions are settled for the rest of the frame
+	grid.rebuild();
 }
 
 void PhysicsSystem::tickEntity(EntityService *es, EntityID e, float dt)
 {
 	auto *physics = es->getComponent<PhysicsComponent>(e, COMPONENT_PHYSICS);
+	es->getSpatialGrid().insert(e, physics->getTilePosition());
 
 	// move
 	physics->body->SetLinearVelocity(
@@ -77,17 +215,103 @@ void PhysicsSystem::tickEntity(EntityService *es, EntityID e, float dt)
 		physics->lastVelocity = Utils::toB2Vec(physics->getVelocity());
 }
 
-void tempDrawVector(PhysicsComponent *physics, const sf::Vector2f vector, sf::Color colour, sf::RenderWindow &window)
+void tempDrawVector(PhysicsComponent *physics, const sf::Vector2f vector, sf::Color colour, sf::RenderTarget &target)
 {
 	sf::RectangleShape r;
 	r.rotate(atan2(vector.y, vector.x) * Math::radToDeg);
 	r.move(physics->getPosition());
 	r.setSize(sf::Vector2f(Math::length(vector) * Constants::tileSizef / 2, 1.0f));
 	r.setFillColor(colour);
-	window.draw(r);
+	target.draw(r);
+}
+
+RenderSystem::RenderSystem() : System(COMPONENT_PHYSICS | COMPONENT_RENDER), batch(MAX_ENTITIES, true), time(0.f),
+							   lastTicked(MAX_ENTITIES, 0.f)
+{
+	cullMargin = Config::getFloat("display.cull-margin", 2.f);
+	clockDriven = Config::getBool("display.clock-animations", true);
+}
+
+void RenderSystem::tick(EntityService *es, float dt)
+{
+	time += dt;
+
+	// evaluated when drawn instead
+	if (clockDriven)
+		return;
+
+	CameraService *camera = Locator::locate<CameraService>(false);
+	findVisible(es, camera == nullptr ? nullptr : &camera->getView(), visible);
+
+	// animations off screen are skipped, and catch up when they come back into view
+	for (EntityID e : visible)
+	{
+		tickEntity(es, e, time - lastTicked[e]);
+		lastTicked[e] = time;
+	}
+}
+
+void RenderSystem::findVisible(EntityService *es, const sf::View *view, std::vector<EntityID> &out)
+{
+	out.clear();
+
+	if (view == nullptr)
+	{
+		for (EntityID e = 0; e < MAX_ENTITIES; ++e)
+		{
+			if ((es->getComponentMask(e) & mask) == mask)
+				out.push_back(e);
+		}
+		return;
+	}
+
+	sf::Vector2f size(view->getSize() / Constants::tileSizef);
+	sf::Vector2f corner(view->getCenter() / Constants::tileSizef - size / 2.f);
+	sf::FloatRect area(corner.x - cullMargin, corner.y - cullMargin,
+					   size.x + cullMargin * 2, size.y + cullMargin * 2);
+
+	es->getSpatialGrid().query(area, out);
+
+	// the grid is from this frame's physics step, so entities may have since lost their components
+	out.erase(std::remove_if(out.begin(), out.end(), [&](EntityID e)
+	{
+		return (es->getComponentMask(e) & mask) != mask;
+	}), out.end());
+
+	std::sort(out.begin(), out.end());
 }
 
-void RenderSystem::renderEntity(EntityService *es, EntityID e, sf::RenderWindow &window)
+void RenderSystem::render(EntityService *es, sf::RenderTarget &target)
+{
+	findVisible(es, &target.getView(), visible);
+
+	batch.begin();
+	for (EntityID e : visible)
+	{
+		if (clockDriven)
+			updateAnimation(es, e).evaluate(time);
+
+		renderEntity(es, e, target);
+	}
+
+	std::size_t drawCalls = batch.end(target);
+
+	RenderService *renderService = Locator::locate<RenderService>(false);
+	if (renderService != nullptr)
+		renderService->countDraws(drawCalls, batch.getSpriteCount() * 4);
+
+	// debug
+	if (Config::getBool("debug.render-physics", false))
+	{
+		for (EntityID e : visible)
+		{
+			auto *physics = es->getComponent<PhysicsComponent>(e, COMPONENT_PHYSICS);
+			tempDrawVector(physics, physics->getVelocity(), sf::Color::Green, target);
+		}
+	}
+}
+
+void RenderSystem::renderEntity(EntityService *es, EntityID e, sf::RenderTarget &target)
 {
 	auto render = es->getComponent<RenderComponent>(e, COMPONENT_RENDER);
 	auto *physics = es->getComponent<PhysicsComponent>(e, COMPONENT_PHYSICS);
@@ -105,9 +329,5 @@ void RenderSystem::renderEntity(EntityService *es, EntityID e, sf::RenderWindow
 	transform.scale(scale, scale);
 
 	states.transform *= transform;
-	render->anim.draw(window, states);
-
-	// debug
-	if (Config::getBool("debug.render-physics", false))
-		tempDrawVector(physics, physics->getVelocity(), sf::Color::Green, window);
+	render->anim.draw(batch, states);
 }
\ No newline at end of file
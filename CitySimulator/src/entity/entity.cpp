@@ -1,4 +1,5 @@
 #include "ai.hpp"
+#include "avoidance.hpp"
 #include "world.hpp"
 #include "bodydata.hpp"
 #include "service/locator.hpp"
@@ -13,6 +14,8 @@ void EntityService::onEnable()
 	loadEntities(config, ENTITY_HUMAN, "human");
 	loadEntities(config, ENTITY_VEHICLE, "vehicle");
 
+	Behaviour::loadTrees(Config::getResource("entities.behaviours"), behaviours);
+
 
 	// init entities
 	for (size_t i = 0; i < MAX_ENTITIES; ++i)
@@ -20,6 +23,7 @@ void EntityService::onEnable()
 
 	// init systems in correct order
 	systems.push_back(new InputSystem);
+	systems.push_back(new AvoidanceSystem);
 	systems.push_back(new PhysicsSystem);
 
 	auto render = new RenderSystem;
@@ -133,6 +137,9 @@ void EntityService::killEntity(EntityID e)
 	if (isAlive(e))
 		entityCount--;
 
+	if (hasComponent(e, COMPONENT_INPUT))
+		removeComponent(e, COMPONENT_INPUT);
+
 	entities[e] = COMPONENT_UNKNOWN;
 }
 
@@ -142,6 +149,12 @@ bool EntityService::isAlive(EntityID e) const
 	return entities[e] != COMPONENT_UNKNOWN;
 }
 
+const BehaviourTree *EntityService::getBehaviour(const std::string &name) const
+{
+	auto it = behaviours.find(name);
+	return it == behaviours.end() ? nullptr : &it->second;
+}
+
 boost::optional<EntityIdentifier *> EntityService::getEntityIDFromBody(const b2Body &body)
 {
 	auto data = static_cast<BodyData *>(body.GetFixtureList()[0].GetUserData());
@@ -160,7 +173,7 @@ void EntityService::tickSystems(float delta)
 
 void EntityService::renderSystems()
 {
-	renderSystem->render(this, *Locator::locate<RenderService>()->getWindow());
+	renderSystem->render(this, *Locator::locate<RenderService>()->getTarget());
 }
 
 BaseComponent *EntityService::addComponent(EntityID e, ComponentType type)
@@ -177,6 +190,11 @@ void EntityService::removeComponent(EntityID e, ComponentType type)
 {
 	validateEntity(e);
 	entities[e] &= ~type;
+
+	// no longer has a brain to wake
+	ClockService *clock = Locator::locate<ClockService>(false);
+	if ((type & COMPONENT_INPUT) != 0 && clock != nullptr)
+		clock->removeEntity(e);
 }
 
 bool EntityService::hasComponent(EntityID e, ComponentType type) const
@@ -254,17 +272,33 @@ void EntityService::addRenderComponent(const EntityIdentifier &entity, const std
 	AnimationService *as = Locator::locate<AnimationService>();
 	Animation *anim = as->getAnimation(entity.type, animation);
 	comp->anim.init(anim, step, initialDirection, playing);
+	renderSystem->resetTicked(entity.id);
 }
 
 void EntityService::addPlayerInputComponent(EntityID e)
 {
 	addComponent(e, COMPONENT_INPUT);
 	Locator::locate<InputService>()->setPlayerEntity(e);
+	trackBrain(e);
 }
 
-void EntityService::addAIInputComponent(EntityID e)
+void EntityService::addAIInputComponent(EntityID e, const std::string &behaviour)
 {
+	std::string name(behaviour.empty() ? Config::getString("ai.behaviour.default", "citizen") : behaviour);
+
+	const BehaviourTree *tree = getBehaviour(name);
+	if (tree == nullptr)
+		Logger::logWarning(format("Behaviour '%1%' not found for entity %2%", name, _str(e)));
+
 	InputComponent *comp = dynamic_cast<InputComponent *>(addComponent(e, COMPONENT_INPUT));
-	comp->brain.reset(new EntityBrain(e)); // todo allocate on stack
+	comp->brain.reset(new EntityBrain(e, tree)); // todo allocate on stack
+	trackBrain(e);
+}
+
+void EntityService::trackBrain(EntityID e)
+{
+	ClockService *clock = Locator::locate<ClockService>(false);
+	if (clock != nullptr)
+		clock->addEntity(e);
 }
 
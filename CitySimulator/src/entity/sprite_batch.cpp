@@ -0,0 +1,122 @@
+#include <algorithm>
+#include "sprite_batch.hpp"
+
+SpriteBatch::SpriteBatch(std::size_t capacity, bool depthSorted) : depthSorted(depthSorted)
+{
+	vertices.reserve(capacity * 4);
+	textures.reserve(capacity);
+	depths.reserve(capacity);
+
+	if (depthSorted)
+	{
+		keys.reserve(capacity);
+		order.reserve(capacity);
+		scratch.reserve(capacity);
+		sortedVertices.reserve(capacity * 4);
+	}
+}
+
+void SpriteBatch::begin()
+{
+	vertices.clear();
+	textures.clear();
+	depths.clear();
+}
+
+void SpriteBatch::add(const sf::Vertex *quad, const sf::RenderStates &states)
+{
+	float depth = 0.f;
+	for (int i = 0; i < 4; ++i)
+	{
+		sf::Vertex vertex(quad[i]);
+		vertex.position = states.transform.transformPoint(vertex.position);
+		vertices.push_back(vertex);
+
+		depth = i == 0 ? vertex.position.y : std::max(depth, vertex.position.y);
+	}
+
+	textures.push_back(states.texture);
+	depths.push_back(depth);
+}
+
+void SpriteBatch::sort()
+{
+	const std::size_t count = depths.size();
+
+	order.resize(count);
+	for (std::size_t i = 0; i < count; ++i)
+		order[i] = static_cast<unsigned>(i);
+
+	if (count < 2)
+		return;
+
+	// quantise to 16 bits over this frame's range
+	auto range = std::minmax_element(depths.begin(), depths.end());
+	float minDepth = *range.first;
+	float spread = *range.second - minDepth;
+	if (spread <= 0.f)
+		return;
+
+	const float scale = 65535.f / spread;
+	keys.resize(count);
+	for (std::size_t i = 0; i < count; ++i)
+		keys[i] = static_cast<uint16_t>((depths[i] - minDepth) * scale);
+
+	// least significant byte first, which keeps equal keys in insertion order
+	scratch.resize(count);
+	for (int shift = 0; shift < 16; shift += 8)
+	{
+		std::size_t offsets[257] = {0};
+		for (unsigned index : order)
+			++offsets[((keys[index] >> shift) & 0xFF) + 1];
+
+		for (int i = 0; i < 256; ++i)
+			offsets[i + 1] += offsets[i];
+
+		for (unsigned index : order)
+			scratch[offsets[(keys[index] >> shift) & 0xFF]++] = index;
+
+		order.swap(scratch);
+	}
+}
+
+std::size_t SpriteBatch::end(sf::RenderTarget &target, sf::RenderStates states)
+{
+	const sf::Vertex *drawVertices = vertices.data();
+	std::size_t count = textures.size();
+
+	// copy sprites into draw order
+	if (depthSorted)
+	{
+		sort();
+
+		sortedVertices.resize(vertices.size());
+		for (std::size_t i = 0; i < count; ++i)
+			std::copy_n(&vertices[order[i] * 4], 4, &sortedVertices[i * 4]);
+
+		drawVertices = sortedVertices.data();
+	}
+
+	auto textureAt = [&](std::size_t i)
+	{
+		return textures[depthSorted ? order[i] : i];
+	};
+
+	std::size_t drawCalls = 0;
+	std::size_t runStart = 0;
+
+	for (std::size_t i = 1; i <= count; ++i)
+	{
+		// draw each run of the same texture
+		if (i < count && textureAt(i) == textureAt(runStart))
+			continue;
+
+		states.texture = textureAt(runStart);
+		target.draw(drawVertices + runStart * 4, (i - runStart) * 4, sf::Quads, states);
+		++drawCalls;
+
+		runStart = i;
+	}
+
+	return drawCalls;
+}
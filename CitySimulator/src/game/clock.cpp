@@ -0,0 +1,164 @@
+#include <cmath>
+#include "service/clock_service.hpp"
+#include "service/locator.hpp"
+
+const double secondsPerHour = 60 * 60;
+const double secondsPerDay = secondsPerHour * 24;
+
+ClockService::ClockService() : time(0), timeScale(1.f), sleepingCount(0)
+{
+}
+
+void ClockService::onEnable()
+{
+	setTime(Config::getFloat("simulation.start-hour", 8.f) * secondsPerHour);
+	setTimeScale(Config::getFloat("simulation.time-scale", 60.f));
+
+	// entities with brains created before the clock
+	EntityService *es = Locator::locate<EntityService>(false);
+	if (es != nullptr)
+	{
+		for (EntityID e = 0; e < MAX_ENTITIES; ++e)
+		{
+			if (es->hasComponent(e, COMPONENT_INPUT))
+				addEntity(e);
+		}
+	}
+}
+
+void ClockService::tick(float delta)
+{
+	time += delta * timeScale;
+
+	while (!wakeUps.empty() && wakeUps.top().time <= time)
+	{
+		WakeUp wakeUp = wakeUps.top();
+		wakeUps.pop();
+
+		// cancelled or rescheduled
+		if (wakeUp.generation != generations[wakeUp.entity] || !sleeping[wakeUp.entity])
+			continue;
+
+		wake(wakeUp.entity);
+	}
+}
+
+float ClockService::getHourOfDay() const
+{
+	return static_cast<float>(std::fmod(time, secondsPerDay) / secondsPerHour);
+}
+
+unsigned ClockService::getDay() const
+{
+	return static_cast<unsigned>(time / secondsPerDay);
+}
+
+double ClockService::getNextTimeOfHour(float hour) const
+{
+	double midnight = std::floor(time / secondsPerDay) * secondsPerDay;
+	double next = midnight + hour * secondsPerHour;
+
+	// already passed today
+	if (next <= time)
+		next += secondsPerDay;
+
+	return next;
+}
+
+void ClockService::setTime(double time)
+{
+	this->time = time;
+}
+
+void ClockService::setTimeScale(float timeScale)
+{
+	this->timeScale = timeScale;
+}
+
+void ClockService::scheduleWake(EntityID entity, double wakeTime)
+{
+	ensureCapacity(entity);
+
+	if (!sleeping[entity])
+	{
+		sleeping[entity] = true;
+		++sleepingCount;
+		removeAwake(entity);
+	}
+
+	WakeUp wakeUp;
+	wakeUp.time = wakeTime;
+	wakeUp.entity = entity;
+	wakeUp.generation = ++generations[entity];
+	wakeUps.push(wakeUp);
+}
+
+void ClockService::cancelWake(EntityID entity)
+{
+	if (!isSleeping(entity))
+		return;
+
+	++generations[entity];
+	wake(entity);
+}
+
+void ClockService::addEntity(EntityID entity)
+{
+	ensureCapacity(entity);
+	tracked[entity] = true;
+
+	if (!sleeping[entity] && awakeIndices[entity] < 0)
+	{
+		awakeIndices[entity] = static_cast<int>(awake.size());
+		awake.push_back(entity);
+	}
+}
+
+void ClockService::removeEntity(EntityID entity)
+{
+	if (entity < 0 || entity >= static_cast<EntityID>(tracked.size()))
+		return;
+
+	cancelWake(entity);
+	removeAwake(entity);
+	tracked[entity] = false;
+}
+
+void ClockService::wake(EntityID entity)
+{
+	sleeping[entity] = false;
+	--sleepingCount;
+
+	if (tracked[entity])
+		addEntity(entity);
+}
+
+void ClockService::removeAwake(EntityID entity)
+{
+	int index = awakeIndices[entity];
+	if (index < 0)
+		return;
+
+	// swap with the last
+	EntityID last = awake.back();
+	awake[index] = last;
+	awakeIndices[last] = index;
+
+	awake.pop_back();
+	awakeIndices[entity] = -1;
+}
+
+void ClockService::ensureCapacity(EntityID entity)
+{
+	if (entity < 0)
+		error("Cannot schedule a wake up for invalid entity %1%", _str(entity));
+
+	size_t size = static_cast<size_t>(entity) + 1;
+	if (size > sleeping.size())
+	{
+		sleeping.resize(size, false);
+		generations.resize(size, 0);
+		awakeIndices.resize(size, -1);
+		tracked.resize(size, false);
+	}
+}
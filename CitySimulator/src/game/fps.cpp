@@ -1,5 +1,6 @@
 #include "constants.hpp"
 #include "game.hpp"
+#include "service/locator.hpp"
 
 void FPSCounter::init(float waitTime)
 {
@@ -12,7 +13,7 @@ void FPSCounter::init(float waitTime)
 }
 
 
-void FPSCounter::tick(float delta, sf::RenderWindow &window)
+void FPSCounter::tick(float delta, sf::RenderTarget &target)
 {
 	backlog.push_back(delta * 1000); // ms
 
@@ -23,14 +24,19 @@ void FPSCounter::tick(float delta, sf::RenderWindow &window)
 		if (!backlog.empty())
 			fps = accumulate(backlog.begin(), backlog.end(), 0.f) / backlog.size();
 
-		const size_t bufferLength = 32;
+		RenderService *renderService = Locator::locate<RenderService>();
+		std::size_t drawCalls = renderService->getDrawCalls();
+		std::size_t vertices = renderService->getSubmittedVertices();
+
+		const size_t bufferLength = 96;
 		char buffer[bufferLength];
-		snprintf(buffer, bufferLength, "%.2f mspf\n%.2f fps", fps, fps == 0 ? 0 : 1000.f / fps);
+		snprintf(buffer, bufferLength, "%.2f mspf\n%.2f fps\n%lu draws\n%lu vertices", fps,
+				 fps == 0 ? 0 : 1000.f / fps, static_cast<unsigned long>(drawCalls), static_cast<unsigned long>(vertices));
 		fpsText.setString(buffer);
 
 		backlog.clear();
 	}
 
-	window.draw(fpsText);
+	target.draw(fpsText);
 }
 
@@ -10,10 +10,14 @@ Game::Game(sf::RenderWindow &window) : BaseGame(window), current(nullptr)
 	limitFrameRate(Config::getInt("display.fps-limit", 60), Config::getBool("display.vsync", true));
 }
 
+Game::Game(sf::RenderTexture &texture) : BaseGame(texture), current(nullptr)
+{
+	showFPS = true;
+}
+
 void Game::start()
 {
 	switchState(StateType::STATE_GAME);
-	box2DWorld = dynamic_cast<GameState *>(current)->getBox2DWorld();
 }
 
 Game::~Game()
@@ -30,12 +34,9 @@ void Game::tick(float delta)
 	current->tick(delta);
 }
 
-void Game::render(sf::RenderWindow &window)
+void Game::render(sf::RenderTarget &target)
 {
-	current->render(window);
-
-	if (box2DWorld != nullptr)
-		box2DWorld->DrawDebugData();
+	current->render(target);
 }
 
 void Game::switchState(StateType newStateType)
@@ -67,7 +68,8 @@ void Game::switchState(StateType newStateType)
 	}
 
 	auto window = Locator::locate<RenderService>()->getWindow();
-	window->setMouseCursorVisible(current->showMouse);
+	if (window != nullptr)
+		window->setMouseCursorVisible(current->showMouse);
 }
 
 State *Game::createFromStateType(StateType type)
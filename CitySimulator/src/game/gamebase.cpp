@@ -1,4 +1,7 @@
 #include <SFML/Window.hpp>
+#include <boost/filesystem.hpp>
+#include <iomanip>
+#include <sstream>
 #include "game.hpp"
 #include "state/gamestate.hpp"
 #include "events.hpp"
@@ -12,6 +15,18 @@ BaseGame::BaseGame(sf::RenderWindow &window)
 	// set icon
 	setWindowIcon(Config::getResource("misc.icon"));
 
+	window.setKeyRepeatEnabled(false);
+	init();
+}
+
+BaseGame::BaseGame(sf::RenderTexture &texture)
+{
+	Locator::provide(SERVICE_RENDER, new RenderService(texture));
+	init();
+}
+
+void BaseGame::init()
+{
 	// load font
 	if (!Constants::mainFont.loadFromFile(Config::getResource("misc.font")))
 	{
@@ -19,9 +34,7 @@ BaseGame::BaseGame(sf::RenderWindow &window)
 		exit(-1);
 	}
 
-
 	// key bindings
-	window.setKeyRepeatEnabled(false);
 	Locator::provide(SERVICE_INPUT, new InputService);
 
 	Logger::logInfo("Game started");
@@ -29,29 +42,42 @@ BaseGame::BaseGame(sf::RenderWindow &window)
 
 void BaseGame::beginGame()
 {
-	sf::RenderWindow *window = Locator::locate<RenderService>()->getWindow();
-
-	// position
-	auto windowSize = window->getSize();
-	window->setPosition({
-								Config::getInt("display.position.x") - static_cast<int>(windowSize.x / 2),
-								Config::getInt("display.position.y") - static_cast<int>(windowSize.y / 2)
-						});
+	RenderService *renderService = Locator::locate<RenderService>();
+	sf::RenderWindow *window = renderService->getWindow();
 
-	// initially fill screen
-	window->clear(backgroundColour);
-	window->display();
+	if (window != nullptr)
+	{
+		// position
+		auto windowSize = window->getSize();
+		window->setPosition({
+									Config::getInt("display.position.x") - static_cast<int>(windowSize.x / 2),
+									Config::getInt("display.position.y") - static_cast<int>(windowSize.y / 2)
+							});
+
+		// initially fill screen
+		window->clear(backgroundColour);
+		window->display();
+	}
 
 	start();
 
 	fps.init(Config::getFloat("debug.fps-tick-rate"));
 
+	if (window != nullptr)
+		runWindowed(*window);
+	else
+		runHeadless(*static_cast<sf::RenderTexture *>(renderService->getTarget()));
+}
+
+void BaseGame::runWindowed(sf::RenderWindow &initialWindow)
+{
+	sf::RenderWindow *window = &initialWindow;
 	sf::Clock clock;
 	sf::Event e;
 
 	// todo separate physics from rendering
 
-	while (window->isOpen())
+	while (Locator::locate<RenderService>()->isOpen())
 	{
 		window = Locator::locate<RenderService>()->getWindow();
 		EventService *es = Locator::locate<EventService>();
@@ -106,31 +132,89 @@ void BaseGame::beginGame()
 		tick(delta);
 
 		// render
-		window->clear(backgroundColour);
-		render(*window);
+		renderFrame(*window, delta);
+		window->display();
+	}
+}
 
-		// overlay
-		if (showFPS)
-		{
-			// restore to default for gui display
-			auto windowSize = window->getSize();
-			window->setView(sf::View(sf::FloatRect(0, 0, windowSize.x, windowSize.y)));
-			fps.tick(delta, *window);
-		}
+void BaseGame::runHeadless(sf::RenderTexture &texture)
+{
+	// a fixed step keeps runs comparable, regardless of how long each frame takes to render
+	const int frameCount = Config::getInt("display.headless.frames", 0);
+	const float delta = Config::getFloat("display.headless.delta", 1.f / 60);
+	const int dumpInterval = Config::getInt("display.headless.dump-interval", 0);
+	const std::string dumpDirectory(Config::getString("display.headless.dump-directory", "frames"));
 
-		window->display();
+	if (dumpInterval > 0)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(dumpDirectory, ec);
 	}
+
+	Logger::logInfo(format("Rendering %1% frames headless at %2%x%3%",
+						   frameCount > 0 ? _str(frameCount) : "unlimited",
+						   _str(texture.getSize().x), _str(texture.getSize().y)));
+
+	RenderService *renderService = Locator::locate<RenderService>();
+	sf::Clock total;
+	sf::Clock clock;
+	int frame = 0;
+
+	while (renderService->isOpen() && (frameCount <= 0 || frame < frameCount))
+	{
+		Locator::locate<EventService>()->processQueue();
+		tick(delta);
+
+		// the overlay shows the real frame time
+		renderFrame(texture, clock.restart().asSeconds());
+		texture.display();
+
+		if (dumpInterval > 0 && frame % dumpInterval == 0)
+			dumpFrame(texture, dumpDirectory, frame);
+
+		++frame;
+	}
+
+	float seconds = total.getElapsedTime().asSeconds();
+	Logger::logInfo(format("Rendered %1% headless frames in %2%s, averaging %3% mspf", _str(frame), _str(seconds),
+						   _str(frame == 0 ? 0.f : seconds * 1000.f / frame)));
+}
+
+void BaseGame::renderFrame(sf::RenderTarget &target, float delta)
+{
+	target.clear(backgroundColour);
+	render(target);
+
+	// overlay
+	if (showFPS)
+	{
+		// restore to default for gui display
+		auto targetSize = target.getSize();
+		target.setView(sf::View(sf::FloatRect(0, 0, targetSize.x, targetSize.y)));
+		fps.tick(delta, target);
+	}
+}
+
+void BaseGame::dumpFrame(const sf::RenderTexture &texture, const std::string &directory, int frame)
+{
+	std::ostringstream path;
+	path << directory << "/frame_" << std::setw(6) << std::setfill('0') << frame << ".png";
+
+	if (!texture.getTexture().copyToImage().saveToFile(path.str()))
+		Logger::logWarning(format("Could not save frame to %1%", path.str()));
 }
 
 void BaseGame::endGame()
 {
 	end();
-	Locator::locate<RenderService>()->getWindow()->close();
+	Locator::locate<RenderService>()->close();
 }
 
 void BaseGame::limitFrameRate(int limit, bool vsync)
 {
 	auto window = Locator::locate<RenderService>()->getWindow();
+	if (window == nullptr)
+		return;
 
 	window->setFramerateLimit(limit);
 	window->setVerticalSyncEnabled(vsync);
@@ -146,5 +230,8 @@ void BaseGame::setWindowIcon(const std::string &path)
 	}
 
 	auto window = Locator::locate<RenderService>()->getWindow();
+	if (window == nullptr)
+		return;
+
 	window->setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
 }
@@ -154,7 +154,7 @@ void InputService::handleKeyEvent(const Event &event)
 	if (binding == KEY_EXIT)
 	{
 		Logger::logDebug("Exit key pressed, quitting");
-		Locator::locate<RenderService>()->getWindow()->close();
+		Locator::locate<RenderService>()->close();
 		return;
 	}
 
@@ -247,7 +247,7 @@ void MovementController::tick(PhysicsComponent *phys, float delta)
 {
 	float maxSpeed;
 	b2Vec2 steering(tick(delta, maxWalkSpeed));
-	phys->steering.Set(steering.x, steering.y);
+	phys->desiredSteering.Set(steering.x, steering.y);
 	phys->maxSpeed = maxWalkSpeed;
 }
 
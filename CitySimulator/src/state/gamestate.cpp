@@ -42,6 +42,9 @@ GameState::GameState() : State(STATE_GAME)
 	// load camera
 	Locator::provide(SERVICE_CAMERA, new CameraService(*world));
 
+	// start the clock
+	Locator::provide(SERVICE_CLOCK, new ClockService);
+
 	// create some humans
 	int count = Config::getInt("debug.humans.count");
 
@@ -59,12 +62,15 @@ void GameState::tick(float delta)
 	world->tick(delta);
 
 	Locator::locate<CameraService>()->tick(delta);
+	Locator::locate<ClockService>()->tick(delta);
 	Locator::locate<EntityService>()->tickSystems(delta);
 }
 
-void GameState::render(sf::RenderWindow &window)
+void GameState::render(sf::RenderTarget &target)
 {
+	world->getTerrain().applyChanges();
 	Locator::locate<RenderService>()->render(*world);
+	world->getCollisionMap().renderDebug();
 }
 
 b2World *GameState::getBox2DWorld()
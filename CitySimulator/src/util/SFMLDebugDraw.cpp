@@ -14,113 +14,182 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <SFML/Graphics.hpp>
+#include <algorithm>
 #include "SFMLDebugDraw.h"
 
-SFMLDebugDraw::SFMLDebugDraw(sf::RenderWindow &window) : m_window(&window)
+const int circleSegments = 16;
+
+SFMLDebugDraw::SFMLDebugDraw(sf::RenderTarget &target) : m_target(&target), m_lines(sf::Lines),
+														 m_triangles(sf::Triangles)
 {
 }
 
-void SFMLDebugDraw::DrawPolygon(const b2Vec2 *vertices, int32 vertexCount, const b2Color &color)
+void SFMLDebugDraw::DrawVisible(const b2World &world)
+{
+	if ((GetFlags() & e_shapeBit) == 0)
+		return;
+
+	const sf::View &view = m_target->getView();
+	sf::Vector2f lower((view.getCenter() - view.getSize() / 2.f) / sfdd::SCALE);
+	sf::Vector2f upper((view.getCenter() + view.getSize() / 2.f) / sfdd::SCALE);
+
+	b2AABB aabb;
+	aabb.lowerBound = b2Vec2(lower.x, lower.y);
+	aabb.upperBound = b2Vec2(upper.x, upper.y);
+
+	m_visible.clear();
+	VisibleFixtures callback(m_visible);
+	world.QueryAABB(&callback, aabb);
+
+	// chains are reported once per edge
+	std::sort(m_visible.begin(), m_visible.end());
+	m_visible.erase(std::unique(m_visible.begin(), m_visible.end()), m_visible.end());
+
+	for (b2Fixture *fixture : m_visible)
+		DrawFixture(fixture);
+
+	Flush();
+}
+
+void SFMLDebugDraw::Flush()
+{
+	if (m_triangles.getVertexCount() != 0)
+		m_target->draw(m_triangles);
+	if (m_lines.getVertexCount() != 0)
+		m_target->draw(m_lines);
+
+	m_triangles.clear();
+	m_lines.clear();
+}
+
+void SFMLDebugDraw::DrawFixture(b2Fixture *fixture)
 {
-	sf::ConvexShape polygon(vertexCount);
-	sf::Vector2f center;
-	for (int i = 0; i < vertexCount; i++)
+	// same colours as b2World::DrawDebugData
+	const b2Body *body = fixture->GetBody();
+	b2Color color(0.9f, 0.7f, 0.7f);
+	if (!body->IsActive())
+		color = b2Color(0.5f, 0.5f, 0.3f);
+	else if (body->GetType() == b2_staticBody)
+		color = b2Color(0.5f, 0.9f, 0.5f);
+	else if (body->GetType() == b2_kinematicBody)
+		color = b2Color(0.5f, 0.5f, 0.9f);
+	else if (!body->IsAwake())
+		color = b2Color(0.6f, 0.6f, 0.6f);
+
+	const b2Transform &xf = body->GetTransform();
+
+	switch (fixture->GetType())
 	{
-		//polygon.setPoint(i, SFMLDraw::B2VecToSFVec(vertices[i]));
-		sf::Vector2f transformedVec = SFMLDebugDraw::B2VecToSFVec(vertices[i]);
-		polygon.setPoint(i, sf::Vector2f(std::floor(transformedVec.x), std::floor(
-				transformedVec.y))); // flooring the coords to fix distorted lines on flat surfaces
-	} // they still show up though.. but less frequently
-	polygon.setOutlineThickness(-1.f);
-	polygon.setFillColor(sf::Color::Transparent);
-	polygon.setOutlineColor(SFMLDebugDraw::GLColorToSFML(color));
-
-	m_window->draw(polygon);
+		case b2Shape::e_circle:
+		{
+			const b2CircleShape *circle = static_cast<const b2CircleShape *>(fixture->GetShape());
+			DrawSolidCircle(b2Mul(xf, circle->m_p), circle->m_radius, b2Mul(xf.q, b2Vec2(1.f, 0.f)), color);
+			break;
+		}
+
+		case b2Shape::e_edge:
+		{
+			const b2EdgeShape *edge = static_cast<const b2EdgeShape *>(fixture->GetShape());
+			DrawSegment(b2Mul(xf, edge->m_vertex1), b2Mul(xf, edge->m_vertex2), color);
+			break;
+		}
+
+		case b2Shape::e_chain:
+		{
+			const b2ChainShape *chain = static_cast<const b2ChainShape *>(fixture->GetShape());
+			for (int32 i = 1; i < chain->m_count; ++i)
+				DrawSegment(b2Mul(xf, chain->m_vertices[i - 1]), b2Mul(xf, chain->m_vertices[i]), color);
+			break;
+		}
+
+		case b2Shape::e_polygon:
+		{
+			const b2PolygonShape *polygon = static_cast<const b2PolygonShape *>(fixture->GetShape());
+			b2Vec2 vertices[b2_maxPolygonVertices];
+			for (int32 i = 0; i < polygon->m_count; ++i)
+				vertices[i] = b2Mul(xf, polygon->m_vertices[i]);
+
+			DrawSolidPolygon(vertices, polygon->m_count, color);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void SFMLDebugDraw::AddLine(const b2Vec2 &p1, const b2Vec2 &p2, const sf::Color &color)
+{
+	m_lines.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(p1), color));
+	m_lines.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(p2), color));
+}
+
+void SFMLDebugDraw::AddCircle(const b2Vec2 &center, float32 radius, const sf::Color &outline, const sf::Color *fill)
+{
+	b2Vec2 previous(center.x + radius, center.y);
+	for (int i = 1; i <= circleSegments; ++i)
+	{
+		float32 angle = i * 2.f * b2_pi / circleSegments;
+		b2Vec2 current(center.x + radius * std::cos(angle), center.y + radius * std::sin(angle));
+
+		if (fill != nullptr)
+		{
+			m_triangles.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(center), *fill));
+			m_triangles.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(previous), *fill));
+			m_triangles.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(current), *fill));
+		}
+
+		AddLine(previous, current, outline);
+		previous = current;
+	}
+}
+
+void SFMLDebugDraw::DrawPolygon(const b2Vec2 *vertices, int32 vertexCount, const b2Color &color)
+{
+	sf::Color outline(SFMLDebugDraw::GLColorToSFML(color));
+	for (int32 i = 0; i < vertexCount; ++i)
+		AddLine(vertices[i], vertices[(i + 1) % vertexCount], outline);
 }
 
 void SFMLDebugDraw::DrawSolidPolygon(const b2Vec2 *vertices, int32 vertexCount, const b2Color &color)
 {
-	sf::ConvexShape polygon(vertexCount);
-	for (int i = 0; i < vertexCount; i++)
+	// polygons are convex, so fan out from the first vertex
+	sf::Color fill(SFMLDebugDraw::GLColorToSFML(color, 60));
+	for (int32 i = 2; i < vertexCount; ++i)
 	{
-		//polygon.setPoint(i, SFMLDraw::B2VecToSFVec(vertices[i]));
-		sf::Vector2f transformedVec = SFMLDebugDraw::B2VecToSFVec(vertices[i]);
-		polygon.setPoint(i, sf::Vector2f(std::floor(transformedVec.x), std::floor(
-				transformedVec.y))); // flooring the coords to fix distorted lines on flat surfaces
-	} // they still show up though.. but less frequently
-	polygon.setOutlineThickness(-1.f);
-	polygon.setFillColor(SFMLDebugDraw::GLColorToSFML(color, 60));
-	polygon.setOutlineColor(SFMLDebugDraw::GLColorToSFML(color));
-
-	m_window->draw(polygon);
+		m_triangles.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(vertices[0]), fill));
+		m_triangles.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(vertices[i - 1]), fill));
+		m_triangles.append(sf::Vertex(SFMLDebugDraw::B2VecToSFVec(vertices[i]), fill));
+	}
+
+	DrawPolygon(vertices, vertexCount, color);
 }
 
 void SFMLDebugDraw::DrawCircle(const b2Vec2 &center, float32 radius, const b2Color &color)
 {
-	sf::CircleShape circle(radius * sfdd::SCALE);
-	circle.setOrigin(radius * sfdd::SCALE, radius * sfdd::SCALE);
-	circle.setPosition(SFMLDebugDraw::B2VecToSFVec(center));
-	circle.setFillColor(sf::Color::Transparent);
-	circle.setOutlineThickness(-1.f);
-	circle.setOutlineColor(SFMLDebugDraw::GLColorToSFML(color));
-
-	m_window->draw(circle);
+	AddCircle(center, radius, SFMLDebugDraw::GLColorToSFML(color), nullptr);
 }
 
 void SFMLDebugDraw::DrawSolidCircle(const b2Vec2 &center, float32 radius, const b2Vec2 &axis, const b2Color &color)
 {
-	sf::CircleShape circle(radius * sfdd::SCALE);
-	circle.setOrigin(radius * sfdd::SCALE, radius * sfdd::SCALE);
-	circle.setPosition(SFMLDebugDraw::B2VecToSFVec(center));
-	circle.setFillColor(SFMLDebugDraw::GLColorToSFML(color, 60));
-	circle.setOutlineThickness(1.f);
-	circle.setOutlineColor(SFMLDebugDraw::GLColorToSFML(color));
-
-	b2Vec2 endPoint = center + radius * axis;
-	sf::Vertex line[2] =
-			{
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(center), SFMLDebugDraw::GLColorToSFML(color)),
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(endPoint), SFMLDebugDraw::GLColorToSFML(color)),
-			};
-
-	m_window->draw(circle);
-	m_window->draw(line, 2, sf::Lines);
+	sf::Color outline(SFMLDebugDraw::GLColorToSFML(color));
+	sf::Color fill(SFMLDebugDraw::GLColorToSFML(color, 60));
+
+	AddCircle(center, radius, outline, &fill);
+	AddLine(center, center + radius * axis, outline);
 }
 
 void SFMLDebugDraw::DrawSegment(const b2Vec2 &p1, const b2Vec2 &p2, const b2Color &color)
 {
-	sf::Vertex line[] =
-			{
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(p1), SFMLDebugDraw::GLColorToSFML(color)),
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(p2), SFMLDebugDraw::GLColorToSFML(color))
-			};
-
-	m_window->draw(line, 2, sf::Lines);
+	AddLine(p1, p2, SFMLDebugDraw::GLColorToSFML(color));
 }
 
 void SFMLDebugDraw::DrawTransform(const b2Transform &xf)
 {
 	float lineLength = 0.4f;
 
-	/*b2Vec2 xAxis(b2Vec2(xf.p.x + (lineLength * xf.q.c), xf.p.y + (lineLength * xf.q.s)));*/
-	b2Vec2 xAxis = xf.p + lineLength * xf.q.GetXAxis();
-	sf::Vertex redLine[] =
-			{
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(xf.p), sf::Color::Red),
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(xAxis), sf::Color::Red)
-			};
-
 	// You might notice that the ordinate(Y axis) points downward unlike the one in Box2D testbed
 	// That's because the ordinate in SFML coordinate system points downward while the OpenGL(testbed) points upward
-	/*b2Vec2 yAxis(b2Vec2(xf.p.x + (lineLength * -xf.q.s), xf.p.y + (lineLength * xf.q.c)));*/
-	b2Vec2 yAxis = xf.p + lineLength * xf.q.GetYAxis();
-	sf::Vertex greenLine[] =
-			{
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(xf.p), sf::Color::Green),
-					sf::Vertex(SFMLDebugDraw::B2VecToSFVec(yAxis), sf::Color::Green)
-			};
-
-	m_window->draw(redLine, 2, sf::Lines);
-	m_window->draw(greenLine, 2, sf::Lines);
+	AddLine(xf.p, xf.p + lineLength * xf.q.GetXAxis(), sf::Color::Red);
+	AddLine(xf.p, xf.p + lineLength * xf.q.GetYAxis(), sf::Color::Green);
 }
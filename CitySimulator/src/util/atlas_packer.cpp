@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "atlas_packer.hpp"
+
+/**
+ * @return The smallest power of two that is at least the given value
+ */
+unsigned nextPowerOfTwo(unsigned x)
+{
+	unsigned power = 1;
+	while (power < x)
+		power <<= 1;
+	return power;
+}
+
+bool contains(const sf::IntRect &outer, const sf::IntRect &inner)
+{
+	return inner.left >= outer.left && inner.top >= outer.top &&
+		   inner.left + inner.width <= outer.left + outer.width &&
+		   inner.top + inner.height <= outer.top + outer.height;
+}
+
+AtlasPacker::AtlasPacker(unsigned maxPageSize)
+{
+	// round down to a power of two
+	this->maxPageSize = nextPowerOfTwo(maxPageSize);
+	if (this->maxPageSize > maxPageSize)
+		this->maxPageSize >>= 1;
+}
+
+bool AtlasPacker::pack(const std::vector<sf::Vector2u> &sizes)
+{
+	this->sizes = sizes;
+	placements.assign(sizes.size(), {0, sf::IntRect()});
+	pageSizes.clear();
+
+	for (const sf::Vector2u &size : sizes)
+	{
+		if (size.x > maxPageSize || size.y > maxPageSize)
+			return false;
+	}
+
+	// biggest first
+	std::vector<size_t> remaining;
+	for (size_t i = 0; i < sizes.size(); ++i)
+	{
+		if (sizes[i].x != 0 && sizes[i].y != 0)
+			remaining.push_back(i);
+		else
+			placements[i].rect = sf::IntRect(0, 0, static_cast<int>(sizes[i].x), static_cast<int>(sizes[i].y));
+	}
+
+	std::stable_sort(remaining.begin(), remaining.end(), [&sizes](size_t a, size_t b)
+	{
+		return std::max(sizes[a].x, sizes[a].y) > std::max(sizes[b].x, sizes[b].y);
+	});
+
+	std::vector<std::pair<size_t, sf::IntRect>> placed;
+	std::vector<size_t> leftover;
+
+	while (!remaining.empty())
+	{
+		// start with the smallest square that could hold everything left, then grow
+		unsigned long long area = 0;
+		unsigned widest = 0, tallest = 0;
+		for (size_t index : remaining)
+		{
+			area += static_cast<unsigned long long>(sizes[index].x) * sizes[index].y;
+			widest = std::max(widest, sizes[index].x);
+			tallest = std::max(tallest, sizes[index].y);
+		}
+
+		unsigned side = nextPowerOfTwo(static_cast<unsigned>(std::ceil(std::sqrt(static_cast<double>(area)))));
+		sf::Vector2u pageSize(std::min(maxPageSize, std::max(side, nextPowerOfTwo(widest))),
+							  std::min(maxPageSize, std::max(side, nextPowerOfTwo(tallest))));
+
+		// half the height may be enough
+		if (pageSize.y > 1 && pageSize.y / 2 >= tallest &&
+			static_cast<unsigned long long>(pageSize.x) * (pageSize.y / 2) >= area)
+			pageSize.y /= 2;
+
+		while (true)
+		{
+			packPage(pageSize, remaining, placed, leftover);
+
+			bool full = pageSize.x == maxPageSize && pageSize.y == maxPageSize;
+			if (leftover.empty() || full)
+				break;
+
+			if (pageSize.x <= pageSize.y && pageSize.x < maxPageSize)
+				pageSize.x <<= 1;
+			else
+				pageSize.y <<= 1;
+		}
+
+		unsigned page = static_cast<unsigned>(pageSizes.size());
+		pageSizes.push_back(pageSize);
+
+		for (const auto &pair : placed)
+			placements[pair.first] = {page, pair.second};
+
+		remaining.swap(leftover);
+	}
+
+	return true;
+}
+
+void AtlasPacker::packPage(const sf::Vector2u &pageSize, const std::vector<size_t> &indices,
+						   std::vector<std::pair<size_t, sf::IntRect>> &placed, std::vector<size_t> &leftover) const
+{
+	placed.clear();
+	leftover.clear();
+
+	std::vector<sf::IntRect> freeRects;
+	freeRects.emplace_back(0, 0, pageSize.x, pageSize.y);
+
+	for (size_t index : indices)
+	{
+		const int width = sizes[index].x;
+		const int height = sizes[index].y;
+
+		// best short side fit
+		int bestShort = std::numeric_limits<int>::max();
+		int bestLong = std::numeric_limits<int>::max();
+		sf::IntRect best;
+
+		for (const sf::IntRect &free : freeRects)
+		{
+			if (free.width < width || free.height < height)
+				continue;
+
+			int leftoverX = free.width - width;
+			int leftoverY = free.height - height;
+			int shortSide = std::min(leftoverX, leftoverY);
+			int longSide = std::max(leftoverX, leftoverY);
+
+			if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong))
+			{
+				bestShort = shortSide;
+				bestLong = longSide;
+				best = sf::IntRect(free.left, free.top, width, height);
+			}
+		}
+
+		if (bestShort == std::numeric_limits<int>::max())
+		{
+			leftover.push_back(index);
+			continue;
+		}
+
+		placed.emplace_back(index, best);
+
+		// split every free rect that overlaps the new one into the parts around it
+		std::vector<sf::IntRect> split;
+		for (const sf::IntRect &free : freeRects)
+		{
+			if (!free.intersects(best))
+			{
+				split.push_back(free);
+				continue;
+			}
+
+			if (best.left > free.left)
+				split.emplace_back(free.left, free.top, best.left - free.left, free.height);
+			if (best.left + best.width < free.left + free.width)
+				split.emplace_back(best.left + best.width, free.top,
+								   free.left + free.width - best.left - best.width, free.height);
+			if (best.top > free.top)
+				split.emplace_back(free.left, free.top, free.width, best.top - free.top);
+			if (best.top + best.height < free.top + free.height)
+				split.emplace_back(free.left, best.top + best.height, free.width,
+								   free.top + free.height - best.top - best.height);
+		}
+
+		// remove free rects inside others
+		freeRects.clear();
+		for (size_t i = 0; i < split.size(); ++i)
+		{
+			bool redundant = false;
+			for (size_t j = 0; j < split.size() && !redundant; ++j)
+			{
+				if (i == j || !contains(split[j], split[i]))
+					continue;
+
+				// keep the first of two identical rects
+				redundant = split[i] != split[j] || j < i;
+			}
+
+			if (!redundant)
+				freeRects.push_back(split[i]);
+		}
+	}
+}
+
+float AtlasPacker::getEfficiency() const
+{
+	unsigned long long used = 0;
+	unsigned long long total = 0;
+
+	for (const sf::Vector2u &size : sizes)
+		used += static_cast<unsigned long long>(size.x) * size.y;
+	for (const sf::Vector2u &size : pageSizes)
+		total += static_cast<unsigned long long>(size.x) * size.y;
+
+	return total == 0 ? 0.f : static_cast<float>(static_cast<double>(used) / total);
+}
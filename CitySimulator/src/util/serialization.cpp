@@ -0,0 +1,91 @@
+#include <boost/filesystem.hpp>
+#include "serialization.hpp"
+#include "utils.hpp"
+
+BinaryWriter::BinaryWriter(const std::string &path) : stream(path, std::ios::binary | std::ios::trunc)
+{
+}
+
+void BinaryWriter::writeHeader(const std::string &magic, uint32_t version)
+{
+	writeString(magic);
+	write(version);
+}
+
+void BinaryWriter::writeString(const std::string &s)
+{
+	write(static_cast<uint32_t>(s.size()));
+	stream.write(s.data(), s.size());
+}
+
+BinaryReader::BinaryReader(const std::string &path) : path(path), stream(path, std::ios::binary)
+{
+}
+
+bool BinaryReader::readHeader(const std::string &magic, uint32_t version)
+{
+	if (!stream.is_open())
+		return false;
+
+	try
+	{
+		return readString() == magic && read<uint32_t>() == version;
+	} catch (std::runtime_error &e)
+	{
+		return false;
+	}
+}
+
+std::string BinaryReader::readString()
+{
+	uint32_t length = read<uint32_t>();
+
+	std::string s(length, '\0');
+	if (length != 0)
+		readBytes(&s[0], length);
+
+	return s;
+}
+
+void BinaryReader::readBytes(char *out, size_t count)
+{
+	if (!stream.read(out, count))
+		error("Unexpected end of file while reading '%1%'", path);
+}
+
+bool Serialization::isUpToDate(const std::string &derivedPath, const std::string &sourcePath)
+{
+	boost::system::error_code ec;
+	if (!boost::filesystem::exists(derivedPath, ec) || !boost::filesystem::exists(sourcePath, ec))
+		return false;
+
+	return boost::filesystem::last_write_time(derivedPath) >= boost::filesystem::last_write_time(sourcePath);
+}
+
+uint64_t Serialization::hash(const void *data, size_t length, uint64_t seed)
+{
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	uint64_t result = seed;
+
+	for (size_t i = 0; i < length; ++i)
+	{
+		result ^= bytes[i];
+		result *= 1099511628211ULL;
+	}
+
+	return result;
+}
+
+bool Serialization::hashFile(const std::string &path, uint64_t &out, uint64_t seed)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream.is_open())
+		return false;
+
+	out = seed;
+	char buffer[4096];
+	while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+		out = hash(buffer, static_cast<size_t>(stream.gcount()), out);
+
+	return !stream.bad();
+}
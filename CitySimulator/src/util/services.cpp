@@ -39,6 +39,8 @@ std::string Locator::serviceToString(ServiceType type)
 			return "Animation";
 		case SERVICE_CAMERA:
 			return "Camera";
+		case SERVICE_CLOCK:
+			return "Clock";
 		case SERVICE_CONFIG:
 			return "Config";
 		case SERVICE_ENTITY:
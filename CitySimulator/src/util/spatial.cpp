@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+#include "spatial.hpp"
+
+SpatialGrid::SpatialGrid(float cellSize, unsigned bucketCount) : cellSize(cellSize), bucketCount(bucketCount),
+																 bucketStarts(bucketCount + 1, 0)
+{
+}
+
+void SpatialGrid::clear()
+{
+	pending.clear();
+	entries.clear();
+	std::fill(bucketStarts.begin(), bucketStarts.end(), 0);
+}
+
+void SpatialGrid::insert(EntityID entity, const sf::Vector2f &position)
+{
+	Entry entry;
+	entry.entity = entity;
+	entry.position = position;
+	entry.cellX = toCell(position.x);
+	entry.cellY = toCell(position.y);
+	pending.push_back(entry);
+}
+
+void SpatialGrid::rebuild()
+{
+	// counting sort into buckets
+	std::fill(bucketStarts.begin(), bucketStarts.end(), 0);
+	for (const Entry &entry : pending)
+		++bucketStarts[hashCell(entry.cellX, entry.cellY) + 1];
+
+	for (unsigned i = 1; i <= bucketCount; ++i)
+		bucketStarts[i] += bucketStarts[i - 1];
+
+	entries.resize(pending.size());
+	bucketCursors.assign(bucketStarts.begin(), bucketStarts.end() - 1);
+	for (const Entry &entry : pending)
+		entries[bucketCursors[hashCell(entry.cellX, entry.cellY)]++] = entry;
+
+	pending.clear();
+}
+
+void SpatialGrid::query(const sf::FloatRect &area, std::vector<EntityID> &out) const
+{
+	int minX = toCell(area.left);
+	int minY = toCell(area.top);
+	int maxX = toCell(area.left + area.width);
+	int maxY = toCell(area.top + area.height);
+
+	float right = area.left + area.width;
+	float bottom = area.top + area.height;
+
+	long cellCount = static_cast<long>(maxX - minX + 1) * (maxY - minY + 1);
+
+	// cheaper to check everything than to visit more cells than there are buckets
+	if (cellCount >= bucketCount)
+	{
+		for (const Entry &entry : entries)
+		{
+			if (entry.position.x >= area.left && entry.position.x <= right &&
+				entry.position.y >= area.top && entry.position.y <= bottom)
+				out.push_back(entry.entity);
+		}
+		return;
+	}
+
+	for (int y = minY; y <= maxY; ++y)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			unsigned bucket = hashCell(x, y);
+			for (unsigned i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; ++i)
+			{
+				const Entry &entry = entries[i];
+
+				// another cell sharing this bucket
+				if (entry.cellX != x || entry.cellY != y)
+					continue;
+
+				if (entry.position.x >= area.left && entry.position.x <= right &&
+					entry.position.y >= area.top && entry.position.y <= bottom)
+					out.push_back(entry.entity);
+			}
+		}
+	}
+}
+
+int SpatialGrid::toCell(float coord) const
+{
+	return static_cast<int>(std::floor(coord / cellSize));
+}
+
+unsigned SpatialGrid::hashCell(int x, int y) const
+{
+	unsigned hash = static_cast<unsigned>(x) * 73856093u ^ static_cast<unsigned>(y) * 19349663u;
+	return hash % bucketCount;
+}
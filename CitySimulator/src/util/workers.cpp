@@ -0,0 +1,130 @@
+#include <algorithm>
+#include "workers.hpp"
+
+WorkerPool::WorkerPool(unsigned threadCount) : unfinishedJobs(0), stopping(false)
+{
+	if (threadCount == 0)
+	{
+		unsigned cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 0;
+	}
+
+	for (unsigned i = 0; i < threadCount; ++i)
+		threads.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+	for (std::thread &thread : threads)
+		thread.join();
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t, size_t)> &task, size_t minBatch)
+{
+	if (count == 0)
+		return;
+
+	// split into one range per thread, including this one
+	size_t rangeCount = std::min<size_t>(threads.size() + 1, (count + minBatch - 1) / std::max<size_t>(minBatch, 1));
+	if (rangeCount <= 1)
+	{
+		task(0, count);
+		return;
+	}
+
+	size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		firstError = nullptr;
+
+		for (size_t begin = rangeSize; begin < count; begin += rangeSize)
+		{
+			size_t end = std::min(begin + rangeSize, count);
+			jobs.push_back([&task, begin, end]
+						   {
+							   task(begin, end);
+						   });
+			++unfinishedJobs;
+		}
+	}
+	wake.notify_all();
+
+	// do the first range here
+	runJob([&task, rangeSize]
+		   {
+			   task(0, rangeSize);
+		   });
+
+	// help out with the remainder, then wait for stragglers
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!jobs.empty())
+	{
+		std::function<void()> job(std::move(jobs.front()));
+		jobs.pop_front();
+
+		lock.unlock();
+		runJob(job);
+		lock.lock();
+
+		--unfinishedJobs;
+	}
+
+	finished.wait(lock, [this]
+	{
+		return unfinishedJobs == 0;
+	});
+
+	if (firstError)
+	{
+		std::exception_ptr error(firstError);
+		firstError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void WorkerPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		wake.wait(lock, [this]
+		{
+			return stopping || !jobs.empty();
+		});
+
+		if (stopping)
+			return;
+
+		std::function<void()> job(std::move(jobs.front()));
+		jobs.pop_front();
+
+		lock.unlock();
+		runJob(job);
+		lock.lock();
+
+		if (--unfinishedJobs == 0)
+			finished.notify_all();
+	}
+}
+
+void WorkerPool::runJob(const std::function<void()> &job)
+{
+	try
+	{
+		job();
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!firstError)
+			firstError = std::current_exception();
+	}
+}
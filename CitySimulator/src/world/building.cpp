@@ -68,6 +68,12 @@ Door *Building::getDoorByTile(const sf::Vector2i &tile)
 	return it != doors.end() ? &it->second : nullptr;
 }
 
+void Building::getDoors(std::vector<Door *> &out)
+{
+	for (auto &pair : doors)
+		out.push_back(&pair.second);
+}
+
 int Building::getID() const
 {
 	return buildingID;
@@ -79,6 +85,16 @@ std::string Building::getInsideWorldName() const
 	return insideWorldName;
 }
 
+World *Building::getInsideWorld() const
+{
+	return insideWorld;
+}
+
+void Building::setInsideWorld(World *world)
+{
+	insideWorld = world;
+}
+
 Door *Building::getConnectedDoor(Door *door)
 {
 	World *targetWorld = door->ownedWorld == insideWorld ? outsideWorld : insideWorld;
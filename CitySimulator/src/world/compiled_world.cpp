@@ -0,0 +1,199 @@
+#include <cstring>
+#include <fstream>
+#include <boost/interprocess/file_mapping.hpp>
+#include "compiled_world.hpp"
+#include "world.hpp"
+#include "service/logging_service.hpp"
+
+const char compiledWorldMagic[8] = "CSWORLD";
+const uint32_t compiledWorldVersion = 1;
+
+/**
+ * Appends the given values to the buffer, aligned to 4 bytes
+ * @return The offset of the first value
+ */
+template<class T>
+uint32_t appendSection(std::vector<char> &buffer, const T *values, size_t count)
+{
+	size_t offset = (buffer.size() + 3) & ~static_cast<size_t>(3);
+	buffer.resize(offset + sizeof(T) * count);
+
+	if (count != 0)
+		memcpy(&buffer[offset], values, sizeof(T) * count);
+
+	return static_cast<uint32_t>(offset);
+}
+
+CompiledWorld::CompiledWorld() : data(nullptr), size(0)
+{
+}
+
+void CompiledWorld::compile(const TMX::TileMap &tileMap)
+{
+	sf::Vector2i tileSize(tileMap.width, tileMap.height);
+
+	std::vector<Layer> layers;
+	std::vector<int32_t> flippedGIDs;
+	std::vector<TMX::rot> tiles;
+	std::vector<Object> objects;
+	WorldTerrain::compile(tileMap, layers, flippedGIDs, tiles, objects);
+
+	std::vector<Building> buildings;
+	std::vector<Door> doors;
+	std::string strings;
+	BuildingMap::compile(tileMap, buildings, doors, strings);
+
+	// collisions only need the terrain layer's block types
+	std::vector<BlockType> terrain(static_cast<size_t>(tileSize.x * tileSize.y), BLOCK_BLANK);
+	const TMX::rot *gid = tiles.data();
+	for (const Layer &layer : layers)
+	{
+		if (!isTileLayer(static_cast<LayerType>(layer.type)))
+			continue;
+
+		for (BlockType &blockType : terrain)
+		{
+			BlockType tileBlockType = static_cast<BlockType>(TMX::Tile(*gid++).getGID());
+			if (layer.type == LAYER_TERRAIN && tileBlockType != BLOCK_BLANK)
+				blockType = tileBlockType;
+		}
+	}
+
+	std::vector<WorldObject> worldObjects;
+	for (const Object &object : objects)
+		worldObjects.emplace_back(static_cast<BlockType>(object.blockType), object.rotation,
+								  Utils::toTile(object.position));
+
+	std::vector<CollisionRect> collisionRects;
+	CollisionMap::compile(tileSize, terrain, worldObjects, collisionRects);
+
+	// lay out
+	buffer.assign(sizeof(Header), 0);
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	memcpy(header.magic, compiledWorldMagic, sizeof(header.magic));
+	header.version = compiledWorldVersion;
+	header.tileSize = tileSize;
+
+	auto setSection = [&](Section section, uint32_t offset, size_t count)
+	{
+		header.sections[section].offset = offset;
+		header.sections[section].count = static_cast<uint32_t>(count);
+	};
+
+	setSection(SECTION_LAYERS, appendSection(buffer, layers.data(), layers.size()), layers.size());
+	setSection(SECTION_FLIPPED_GIDS, appendSection(buffer, flippedGIDs.data(), flippedGIDs.size()),
+			   flippedGIDs.size());
+	setSection(SECTION_TILES, appendSection(buffer, tiles.data(), tiles.size()), tiles.size());
+	setSection(SECTION_OBJECTS, appendSection(buffer, objects.data(), objects.size()), objects.size());
+	setSection(SECTION_BUILDINGS, appendSection(buffer, buildings.data(), buildings.size()), buildings.size());
+	setSection(SECTION_DOORS, appendSection(buffer, doors.data(), doors.size()), doors.size());
+	setSection(SECTION_COLLISIONS, appendSection(buffer, collisionRects.data(), collisionRects.size()),
+			   collisionRects.size());
+	setSection(SECTION_STRINGS, appendSection(buffer, strings.data(), strings.size()), strings.size());
+
+	header.size = static_cast<uint32_t>(buffer.size());
+	memcpy(&buffer[0], &header, sizeof(Header));
+
+	boost::interprocess::mapped_region().swap(region);
+	data = buffer.data();
+	size = buffer.size();
+
+	Logger::logDebug(format("Compiled world with %1% layers, %2% objects and %3% collision rects",
+							_str(layers.size()), _str(objects.size()), _str(collisionRects.size())));
+}
+
+bool CompiledWorld::save(const std::string &path) const
+{
+	if (data == nullptr)
+		return false;
+
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	stream.write(data, size);
+	return stream.good();
+}
+
+bool CompiledWorld::open(const std::string &path)
+{
+	boost::interprocess::mapped_region mapped;
+	try
+	{
+		boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region(file, boost::interprocess::read_only).swap(mapped);
+	} catch (boost::interprocess::interprocess_exception &e)
+	{
+		Logger::logWarning(format("Could not map compiled world '%1%': %2%", path, e.what()));
+		return false;
+	}
+
+	const char *previousData = data;
+	size_t previousSize = size;
+
+	data = static_cast<const char *>(mapped.get_address());
+	size = mapped.get_size();
+
+	if (!validate())
+	{
+		Logger::logWarning(format("Invalid compiled world '%1%'", path));
+		data = previousData;
+		size = previousSize;
+		return false;
+	}
+
+	region.swap(mapped);
+	buffer.clear();
+	buffer.shrink_to_fit();
+	return true;
+}
+
+sf::Vector2i CompiledWorld::getTileSize() const
+{
+	return getHeader().tileSize;
+}
+
+std::string CompiledWorld::getString(uint32_t offset, uint32_t length) const
+{
+	Array<char> strings(getSection<char>(SECTION_STRINGS));
+	if (offset > strings.size() || length > strings.size() - offset)
+		error("String at %1% is outside of the compiled world", _str(offset));
+
+	return std::string(strings.begin() + offset, length);
+}
+
+bool CompiledWorld::validate() const
+{
+	if (size < sizeof(Header))
+		return false;
+
+	const Header &header = getHeader();
+	if (memcmp(header.magic, compiledWorldMagic, sizeof(header.magic)) != 0 ||
+		header.version != compiledWorldVersion || header.size != size)
+		return false;
+
+	if (header.tileSize.x < 0 || header.tileSize.y < 0)
+		return false;
+
+	const size_t elementSizes[SECTION_COUNT] = {sizeof(Layer), sizeof(int32_t), sizeof(TMX::rot), sizeof(Object),
+												sizeof(Building), sizeof(Door), sizeof(CollisionRect), sizeof(char)};
+
+	for (int i = 0; i < SECTION_COUNT; ++i)
+	{
+		const SectionHeader &section = header.sections[i];
+		if (section.offset % 4 != 0 || section.offset < sizeof(Header) || section.offset > size ||
+			section.count > (size - section.offset) / elementSizes[i])
+			return false;
+	}
+
+	// every tile layer has a full set of tiles
+	size_t tileLayers = 0;
+	for (const Layer &layer : getLayers())
+	{
+		if (layer.type < 0 || layer.type >= LAYER_UNKNOWN)
+			return false;
+
+		if (isTileLayer(static_cast<LayerType>(layer.type)))
+			++tileLayers;
+	}
+
+	return getTiles().size() == tileLayers * header.tileSize.x * header.tileSize.y;
+}
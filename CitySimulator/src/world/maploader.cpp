@@ -1,6 +1,10 @@
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/tokenizer.hpp>
-#include <boost/lexical_cast.hpp>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <zlib.h>
+#ifdef CITYSIMULATOR_ZSTD
+#include <zstd.h>
+#endif
 #include "maploader.hpp"
 #include "utils.hpp"
 #include "service/logging_service.hpp"
@@ -22,164 +26,691 @@ TMX::PropertyType TMX::propertyTypeFromString(const std::string &s)
 	return PROPERTY_UNKNOWN;
 }
 
-void addProperties(TMX::TileMap *tile_map, boost::property_tree::ptree &tree)
+/**
+ * A view into the file buffer, so nothing is copied until it's needed as a string
+ */
+struct XmlString
 {
-	// properties
-	try
+	const char *begin;
+	const char *end;
+
+	XmlString() : begin(nullptr), end(nullptr)
+	{
+	}
+
+	bool operator==(const char *s) const
+	{
+		size_t length = strlen(s);
+		return static_cast<size_t>(end - begin) == length && memcmp(begin, s, length) == 0;
+	}
+
+	bool operator!=(const char *s) const
 	{
-		boost::property_tree::ptree empty;
-		boost::property_tree::ptree properties = tree.get_child("properties", empty);
-		if (properties.empty())
+		return !(*this == s);
+	}
+
+	/**
+	 * @return A copy with the predefined entities decoded
+	 */
+	std::string str() const
+	{
+		std::string s;
+		s.reserve(end - begin);
+
+		static const char *entities[][2] = {{"&amp;",  "&"},
+											{"&lt;",   "<"},
+											{"&gt;",   ">"},
+											{"&quot;", "\""},
+											{"&apos;", "'"}};
+
+		for (const char *c = begin; c < end; ++c)
 		{
-			Logger::logDebug("No world properties found");
+			bool decoded = false;
+			if (*c == '&')
+			{
+				for (auto &entity : entities)
+				{
+					size_t length = strlen(entity[0]);
+					if (static_cast<size_t>(end - c) >= length && memcmp(c, entity[0], length) == 0)
+					{
+						s += entity[1];
+						c += length - 1;
+						decoded = true;
+						break;
+					}
+				}
+			}
+
+			if (!decoded)
+				s += *c;
+		}
+
+		return s;
+	}
+};
+
+/**
+ * Tokenizes XML in place one tag at a time, skipping text, comments and declarations
+ */
+class XmlReader
+{
+public:
+	enum TagType
+	{
+		TAG_OPEN,
+		TAG_CLOSE,
+		TAG_END_OF_FILE
+	};
+
+	XmlReader(const char *begin, const char *end) : begin(begin), pos(begin), end(end), selfClosing(false)
+	{
+	}
+
+	TagType next()
+	{
+		while (true)
+		{
+			pos = std::find(pos, end, '<');
+			if (pos == end)
+				return TAG_END_OF_FILE;
+			++pos;
+
+			// declarations and comments
+			if (pos < end && *pos == '?')
+			{
+				skipPast("?>");
+				continue;
+			}
+			if (end - pos >= 3 && memcmp(pos, "!--", 3) == 0)
+			{
+				skipPast("-->");
+				continue;
+			}
+			if (pos < end && *pos == '!')
+			{
+				skipPast(">");
+				continue;
+			}
+
+			bool closing = pos < end && *pos == '/';
+			if (closing)
+				++pos;
+
+			name.begin = pos;
+			while (pos < end && !isspace(static_cast<unsigned char>(*pos)) && *pos != '>' && *pos != '/')
+				++pos;
+			name.end = pos;
+
+			readAttributes();
+			return closing ? TAG_CLOSE : TAG_OPEN;
+		}
+	}
+
+	/**
+	 * Skips the children of the current open tag, up to and including its closing tag
+	 */
+	void skipElement()
+	{
+		if (selfClosing)
 			return;
+
+		int depth = 1;
+		while (depth > 0)
+		{
+			TagType type = next();
+			if (type == TAG_END_OF_FILE)
+				fail("Unexpected end of file");
+
+			if (type == TAG_OPEN && !selfClosing)
+				++depth;
+			else if (type == TAG_CLOSE)
+				--depth;
+		}
+	}
+
+	const XmlString &getName() const
+	{
+		return name;
+	}
+
+	bool isSelfClosing() const
+	{
+		return selfClosing;
+	}
+
+	bool getAttribute(const char *attribute, XmlString &out) const
+	{
+		for (const auto &pair : attributes)
+		{
+			if (pair.first == attribute)
+			{
+				out = pair.second;
+				return true;
+			}
 		}
 
-		for (auto &propertyPair : properties)
+		return false;
+	}
+
+	std::string getString(const char *attribute, const std::string &defaultValue = "") const
+	{
+		XmlString value;
+		return getAttribute(attribute, value) ? value.str() : defaultValue;
+	}
+
+	int getInt(const char *attribute, int defaultValue) const
+	{
+		XmlString value;
+		return getAttribute(attribute, value) ? static_cast<int>(strtol(value.begin, nullptr, 10)) : defaultValue;
+	}
+
+	float getFloat(const char *attribute, float defaultValue) const
+	{
+		XmlString value;
+		return getAttribute(attribute, value) ? strtof(value.begin, nullptr) : defaultValue;
+	}
+
+	/**
+	 * The text after the current tag, for reading in place
+	 */
+	const char *getPosition() const
+	{
+		return pos;
+	}
+
+	const char *getEnd() const
+	{
+		return end;
+	}
+
+	void setPosition(const char *position)
+	{
+		pos = position;
+	}
+
+	void fail(const std::string &message) const
+	{
+		error("%1% at byte %2%", message, _str(pos - begin));
+	}
+
+private:
+	const char *begin;
+	const char *pos;
+	const char *end;
+
+	XmlString name;
+	bool selfClosing;
+	std::vector<std::pair<XmlString, XmlString>> attributes;
+
+	void skipPast(const char *terminator)
+	{
+		size_t length = strlen(terminator);
+		pos = std::search(pos, end, terminator, terminator + length);
+		if (pos == end)
+			fail(format("Expected '%1%'", terminator));
+		pos += length;
+	}
+
+	void readAttributes()
+	{
+		attributes.clear();
+		selfClosing = false;
+
+		while (true)
 		{
-			auto name = propertyPair.second.get<std::string>("<xmlattr>.name");
-			auto value = propertyPair.second.get<std::string>("<xmlattr>.value");
+			while (pos < end && isspace(static_cast<unsigned char>(*pos)))
+				++pos;
+
+			if (pos == end)
+				fail("Unexpected end of file in tag");
 
-			Logger::logDebuggier(format("Found world property '%1%' => '%2%'", name, value));
+			if (*pos == '>')
+			{
+				++pos;
+				return;
+			}
 
-			TMX::PropertyType type = TMX::propertyTypeFromString(name);
-			if (type != TMX::PROPERTY_UNKNOWN)
-				tile_map->addProperty(type, value);
+			if (*pos == '/')
+			{
+				selfClosing = true;
+				skipPast(">");
+				return;
+			}
+
+			std::pair<XmlString, XmlString> attribute;
+			attribute.first.begin = pos;
+			while (pos < end && *pos != '=' && !isspace(static_cast<unsigned char>(*pos)))
+				++pos;
+			attribute.first.end = pos;
+
+			while (pos < end && isspace(static_cast<unsigned char>(*pos)))
+				++pos;
+			if (pos == end || *pos != '=')
+				fail("Expected '=' after attribute");
+			++pos;
+
+			while (pos < end && isspace(static_cast<unsigned char>(*pos)))
+				++pos;
+			if (pos == end || (*pos != '"' && *pos != '\''))
+				fail("Expected quoted attribute value");
+
+			char quote = *pos++;
+			attribute.second.begin = pos;
+			pos = std::find(pos, end, quote);
+			if (pos == end)
+				fail("Unterminated attribute value");
+			attribute.second.end = pos++;
+
+			attributes.push_back(attribute);
 		}
 	}
-	catch (std::exception e)
+};
+
+/**
+ * Reads the property children of the current properties tag
+ * @param layerName The layer the properties belong to, or empty for the world's properties
+ */
+void readProperties(XmlReader &reader, TMX::PropertyOwner &owner, const std::string &layerName = "")
+{
+	if (reader.isSelfClosing())
+		return;
+
+	while (true)
 	{
-		// no properties
-		if (strcmp(e.what(), "No such node (properties)") != 0)
-			throw e;
+		XmlReader::TagType type = reader.next();
+		if (type == XmlReader::TAG_END_OF_FILE)
+			reader.fail("Unexpected end of file in properties");
+		if (type == XmlReader::TAG_CLOSE)
+			return;
+
+		if (reader.getName() != "property")
+		{
+			reader.skipElement();
+			continue;
+		}
+
+		std::string name(reader.getString("name"));
+		XmlString valueString;
+		std::string value;
+
+		// multiline values are in the element instead
+		if (reader.getAttribute("value", valueString))
+			value = valueString.str();
+		else if (!reader.isSelfClosing())
+		{
+			valueString.begin = reader.getPosition();
+			valueString.end = std::find(valueString.begin, reader.getEnd(), '<');
+			value = valueString.str();
+		}
+		reader.skipElement();
+
+		Logger::logDebuggier(format("Found property '%1%' => '%2%'", name, value));
+
+		TMX::PropertyType propertyType = TMX::propertyTypeFromString(name);
+		if (propertyType != TMX::PROPERTY_UNKNOWN)
+			owner.addProperty(propertyType, value);
+		else if (!layerName.empty())
+			Logger::logWarning(format("Found unknown property '%1%' in layer '%2%', skipping", name, layerName));
 	}
 }
 
+/**
+ * Parses CSV tile data in place, up to the next tag
+ */
+void readCSV(XmlReader &reader, std::vector<TMX::rot> &gids)
+{
+	const char *pos = reader.getPosition();
+	const char *end = reader.getEnd();
+	size_t count = 0;
 
-int TMX::stripFlip(const int &gid, std::bitset<3> &flips)
+	while (pos < end && *pos != '<')
+	{
+		if (*pos >= '0' && *pos <= '9')
+		{
+			TMX::rot gid = 0;
+			while (pos < end && *pos >= '0' && *pos <= '9')
+				gid = gid * 10 + (*pos++ - '0');
+
+			// extra tiles are ignored
+			if (count < gids.size())
+				gids[count] = gid;
+			++count;
+		}
+		else if (*pos == ',' || isspace(static_cast<unsigned char>(*pos)))
+			++pos;
+		else
+		{
+			reader.setPosition(pos);
+			reader.fail(format("Unexpected '%1%' in CSV layer data", std::string(1, *pos)));
+		}
+	}
+
+	reader.setPosition(pos);
+}
+
+std::vector<signed char> createBase64Table()
 {
-	flips.set(0, (gid & HORIZONTAL) != 0);
-	flips.set(1, (gid & VERTICAL) != 0);
-	flips.set(2, (gid & DIAGONAL) != 0);
+	const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::vector<signed char> table(256, -1);
+	for (int i = 0; i < 64; ++i)
+		table[static_cast<unsigned char>(alphabet[i])] = static_cast<signed char>(i);
 
-	return gid & ~(HORIZONTAL | VERTICAL | DIAGONAL);
+	return table;
 }
 
-TMX::Tile::Tile(TileType type, const std::string &id) : tileType(type)
+/**
+ * Decodes base64 in place, up to the next tag
+ * @return The number of bytes written to out, which must fit in capacity
+ */
+size_t readBase64(XmlReader &reader, unsigned char *out, size_t capacity)
 {
-	gid = boost::lexical_cast<rot>(id);
-	if (gid != 0)
-		gid -= 1;
+	static const std::vector<signed char> table(createBase64Table());
 
-	std::bitset<3> flips;
-	gid = stripFlip(gid, flips);
+	const char *pos = reader.getPosition();
+	const char *end = reader.getEnd();
+	size_t written = 0;
+	uint32_t bits = 0;
+	int bitCount = 0;
 
-	flipped = flips.any();
+	for (; pos < end && *pos != '<'; ++pos)
+	{
+		if (isspace(static_cast<unsigned char>(*pos)) || *pos == '=')
+			continue;
 
-	processRotation(flips);
+		signed char value = table[static_cast<unsigned char>(*pos)];
+		if (value < 0)
+		{
+			reader.setPosition(pos);
+			reader.fail(format("Unexpected '%1%' in base64 layer data", std::string(1, *pos)));
+		}
+
+		bits = (bits << 6) | static_cast<uint32_t>(value);
+		bitCount += 6;
+
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			if (written == capacity)
+			{
+				reader.setPosition(pos);
+				reader.fail(format("Expected at most %1% bytes of base64 layer data", _str(capacity)));
+			}
+
+			out[written++] = static_cast<unsigned char>(bits >> bitCount);
+		}
+	}
+
+	reader.setPosition(pos);
+	return written;
 }
 
-TMX::TileMap *TMX::TileMap::load(const std::string &filePath)
+/**
+ * Decompresses zlib or gzip data into exactly size bytes
+ */
+void inflateLayer(XmlReader &reader, const std::vector<unsigned char> &compressed, unsigned char *out, size_t size)
 {
-	boost::property_tree::ptree tree;
-	read_xml(filePath, tree);
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+	stream.next_in = const_cast<Bytef *>(compressed.data());
+	stream.avail_in = static_cast<uInt>(compressed.size());
+	stream.next_out = out;
+	stream.avail_out = static_cast<uInt>(size);
+
+	// detects either header
+	if (inflateInit2(&stream, 15 + 32) != Z_OK)
+		reader.fail("Could not initialise zlib");
+
+	int result = inflate(&stream, Z_FINISH);
+	std::string message(stream.msg != nullptr ? stream.msg : "");
+	inflateEnd(&stream);
+
+	if (result == Z_BUF_ERROR && stream.avail_out == 0)
+		reader.fail(format("Expected %1% bytes of decompressed layer data, but got more", _str(size)));
+	if (result != Z_STREAM_END)
+		reader.fail(format("Could not decompress layer data (%1%)", message.empty() ? _str(result) : message));
+	if (stream.total_out != size)
+		reader.fail(format("Expected %1% bytes of decompressed layer data, but got %2%", _str(size),
+						   _str(stream.total_out)));
+}
 
-	TileMap *map = new TileMap();
+/**
+ * Decodes base64 layer data, optionally compressed, straight into the gids
+ */
+void readBase64Layer(XmlReader &reader, std::vector<TMX::rot> &gids, const std::string &compression)
+{
+	unsigned char *out = reinterpret_cast<unsigned char *>(gids.data());
+	size_t size = gids.size() * sizeof(TMX::rot);
 
-	map->width = tree.get<int>("map.<xmlattr>.width", 0);
-	map->height = tree.get<int>("map.<xmlattr>.height", 0);
+	if (compression.empty())
+	{
+		size_t written = readBase64(reader, out, size);
+		if (written != size)
+			reader.fail(format("Expected %1% bytes of layer data, but got %2%", _str(size), _str(written)));
+	}
+	else
+	{
+		// the compressed size is at most 3/4 of the text
+		const char *textEnd = std::find(reader.getPosition(), reader.getEnd(), '<');
+		std::vector<unsigned char> compressed((textEnd - reader.getPosition()) / 4 * 3 + 3);
+		compressed.resize(readBase64(reader, compressed.data(), compressed.size()));
 
-	boost::property_tree::ptree treeRoot = tree.get_child("map");
-	addProperties(map, treeRoot);
+		if (compression == "zlib" || compression == "gzip")
+			inflateLayer(reader, compressed, out, size);
 
-	for (auto &pair : treeRoot)
+		else if (compression == "zstd")
+		{
+#ifdef CITYSIMULATOR_ZSTD
+			size_t result = ZSTD_decompress(out, size, compressed.data(), compressed.size());
+			if (ZSTD_isError(result))
+				reader.fail(format("Could not decompress layer data (%1%)", ZSTD_getErrorName(result)));
+			if (result != size)
+				reader.fail(format("Expected %1% bytes of decompressed layer data, but got %2%", _str(size),
+								   _str(result)));
+#else
+			reader.fail("zstd compressed layers need a build with CITYSIMULATOR_ZSTD");
+#endif
+		}
+
+		else
+			reader.fail(format("Unsupported layer compression '%1%'", compression));
+	}
+
+	// stored little endian
+	for (TMX::rot &gid : gids)
 	{
-		if (pair.first != "layer" && pair.first != "objectgroup")
-			continue;
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&gid);
+		gid = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<TMX::rot>(bytes[3]) << 24);
+	}
+}
+
+void readTileLayer(XmlReader &reader, TMX::Layer &layer, size_t tileCount)
+{
+	layer.gids.assign(tileCount, 0);
+
+	if (!reader.isSelfClosing())
+	{
+		while (true)
+		{
+			XmlReader::TagType type = reader.next();
+			if (type == XmlReader::TAG_END_OF_FILE)
+				reader.fail("Unexpected end of file in layer");
+			if (type == XmlReader::TAG_CLOSE)
+				break;
+
+			if (reader.getName() == "data" && !reader.isSelfClosing())
+			{
+				std::string encoding(reader.getString("encoding"));
+				if (encoding == "csv")
+					readCSV(reader, layer.gids);
+				else if (encoding == "base64")
+					readBase64Layer(reader, layer.gids, reader.getString("compression"));
+				else
+					reader.fail(format("Unsupported layer encoding '%1%' in layer '%2%'", encoding, layer.name));
+			}
+
+			reader.skipElement();
+		}
+	}
+}
 
-		Layer *layer = new Layer;
-		layer->name = pair.second.get<std::string>("<xmlattr>.name");
-		layer->visible = pair.second.get<int>("<xmlattr>.visible", 1) != 0;
-		layer->items.reserve(map->width * map->height);
+void readObjectLayer(XmlReader &reader, TMX::Layer &layer)
+{
+	if (reader.isSelfClosing())
+		return;
+
+	while (true)
+	{
+		XmlReader::TagType type = reader.next();
+		if (type == XmlReader::TAG_END_OF_FILE)
+			reader.fail("Unexpected end of file in object group");
+		if (type == XmlReader::TAG_CLOSE)
+			return;
 
-		// tile layerDepths
-		if (pair.first == "layer")
+		if (reader.getName() != "object")
 		{
-			// add all tiles
-			typedef boost::char_separator<char> sep;
-			typedef boost::tokenizer<sep> tk;
+			reader.skipElement();
+			continue;
+		}
 
-			std::string data = pair.second.get<std::string>("data");
-			tk tokens(data, sep(",\n\r"));
+		sf::Vector2f position(reader.getFloat("x", 0.f), reader.getFloat("y", 0.f));
+		XmlString gid;
 
-			for (auto it = tokens.begin(); it != tokens.end(); ++it)
-				layer->items.push_back(new Tile(*it));
+		// has a tile gid
+		if (reader.getAttribute("gid", gid))
+		{
+			TMX::Object obj;
+			obj.gid = static_cast<TMX::rot>(strtoul(gid.begin, nullptr, 10));
+			obj.position = position;
+			obj.rotationAnglef = reader.getFloat("rotation", 0.f);
 
-			layer->items.resize(map->width * map->height);
+			layer.objects.push_back(obj);
+			reader.skipElement();
 		}
 
-			// object layers
+			// property object
 		else
 		{
-			for (auto &o : pair.second)
+			layer.shapes.emplace_back();
+			TMX::PropertyObject &propObj = layer.shapes.back();
+
+			propObj.position = position;
+			propObj.dimensions.x = reader.getFloat("width", 0.f);
+			propObj.dimensions.y = reader.getFloat("height", 0.f);
+
+			if (reader.isSelfClosing())
+				continue;
+
+			while (true)
 			{
-				if (o.first == "object")
-				{
-					float x = o.second.get<float>("<xmlattr>.x");
-					float y = o.second.get<float>("<xmlattr>.y");
-					boost::optional<std::string> gid = o.second.get_optional<std::string>("<xmlattr>.gid");
+				XmlReader::TagType childType = reader.next();
+				if (childType == XmlReader::TAG_END_OF_FILE)
+					reader.fail("Unexpected end of file in object");
+				if (childType == XmlReader::TAG_CLOSE)
+					break;
+
+				if (reader.getName() == "properties")
+					readProperties(reader, propObj, layer.name);
+				else
+					reader.skipElement();
+			}
+		}
+	}
+}
 
-					// has a tile gid
-					if (gid)
-					{
-						Object *obj = new Object(*gid);
+int TMX::stripFlip(const int &gid, std::bitset<3> &flips)
+{
+	flips.set(0, (gid & HORIZONTAL) != 0);
+	flips.set(1, (gid & VERTICAL) != 0);
+	flips.set(2, (gid & DIAGONAL) != 0);
 
-						obj->position.x = x;
-						obj->position.y = y;
-						obj->rotationAnglef = o.second.get<float>("<xmlattr>.rotation", 0.0);
+	return gid & ~(HORIZONTAL | VERTICAL | DIAGONAL);
+}
 
-						layer->items.push_back(obj);
-					}
+TMX::Tile::Tile(rot id)
+{
+	gid = id;
+	if (gid != 0)
+		gid -= 1;
 
-						// property object
-					else
-					{
-						PropertyObject *propObj = new PropertyObject;
-						propObj->position.x = x;
-						propObj->position.y = y;
-						propObj->dimensions.x = o.second.get<float>("<xmlattr>.width");
-						propObj->dimensions.y = o.second.get<float>("<xmlattr>.height");
+	std::bitset<3> flips;
+	gid = stripFlip(gid, flips);
 
+	flipped = flips.any();
 
-						for (auto &prop : o.second.get_child("properties"))
-						{
-							std::string key(prop.second.get<std::string>("<xmlattr>.name"));
-							std::string value(prop.second.get<std::string>("<xmlattr>.value"));
+	processRotation(flips);
+}
 
-							PropertyType propType = propertyTypeFromString(key);
-							if (propType == PROPERTY_UNKNOWN)
-							{
-								Logger::logWarning(format("Found unknown property '%1%' in layer '%2%', skipping",
-								                          layer->name, key));
-								continue;
+TMX::TileMap *TMX::TileMap::load(const std::string &filePath)
+{
+	// the whole file is tokenized in place
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		error("Could not open map '%1%'", filePath);
 
-							}
+	std::string buffer(static_cast<size_t>(file.tellg()), '\0');
+	file.seekg(0);
+	if (!buffer.empty() && !file.read(&buffer[0], buffer.size()))
+		error("Could not read map '%1%'", filePath);
 
-							propObj->addProperty(propType, value);
-						}
-						layer->items.push_back(propObj);
+	std::unique_ptr<TileMap> map(new TileMap);
+	XmlReader reader(buffer.data(), buffer.data() + buffer.size());
 
-					}
-				}
+	try
+	{
+		// find the map
+		while (reader.next() != XmlReader::TAG_OPEN || reader.getName() != "map")
+		{
+			if (reader.getPosition() == reader.getEnd())
+				reader.fail("No map element");
+		}
+
+		map->width = reader.getInt("width", 0);
+		map->height = reader.getInt("height", 0);
+		bool hasProperties = false;
+
+		while (true)
+		{
+			XmlReader::TagType type = reader.next();
+			if (type == XmlReader::TAG_END_OF_FILE)
+				reader.fail("Unexpected end of file in map");
+			if (type == XmlReader::TAG_CLOSE)
+				break;
+
+			const XmlString &name = reader.getName();
+			if (name == "properties")
+			{
+				readProperties(reader, *map);
+				hasProperties = true;
 			}
+
+			else if (name == "layer" || name == "objectgroup")
+			{
+				Layer *layer = new Layer;
+				map->layers.push_back(layer);
+
+				layer->name = reader.getString("name");
+				layer->visible = reader.getInt("visible", 1) != 0;
+
+				if (name == "layer")
+					readTileLayer(reader, *layer, static_cast<size_t>(map->width * map->height));
+				else
+					readObjectLayer(reader, *layer);
+			}
+
+			else
+				reader.skipElement();
 		}
 
-		map->layers.push_back(layer);
+		if (!hasProperties)
+			Logger::logDebug("No world properties found");
+	} catch (std::runtime_error &e)
+	{
+		error("Could not load map '%1%': %2%", filePath, e.what());
 	}
 
-
-	return map;
+	return map.release();
 }
+
 void TMX::Tile::processRotation(std::bitset<3> rotation)
 {
 	rotationAngle = 0;
@@ -220,11 +751,7 @@ void TMX::Tile::processRotation(std::bitset<3> rotation)
 		}
 	}
 }
-TMX::Layer::~Layer()
-{
-	for (Tile *tile : items)
-		delete tile;
-}
+
 TMX::TileMap::~TileMap()
 {
 	for (auto &layer : layers)
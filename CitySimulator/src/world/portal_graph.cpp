@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include "portal_graph.hpp"
+#include "serialization.hpp"
+#include "service/locator.hpp"
+
+const std::string doorCacheMagic("CSDOORS");
+const uint32_t doorCacheVersion = 1;
+
+PortalGraph::PortalGraph() : doorCost(1.f)
+{
+}
+
+void PortalGraph::build(const std::vector<World *> &worlds)
+{
+	doorCost = Config::getFloat("world.door-cost", 1.f);
+
+	nodes.clear();
+	edges.clear();
+	worldNodes.clear();
+
+	// interior doors belong to the outside world's buildings
+	std::vector<Building *> buildings;
+	for (World *world : worlds)
+		world->getBuildingMap().getBuildings(buildings);
+
+	std::vector<Door *> doors;
+	for (Building *building : buildings)
+		building->getDoors(doors);
+
+	// a node per door
+	std::unordered_map<Door *, int> doorNodes;
+	for (Door *door : doors)
+	{
+		if (std::find(worlds.begin(), worlds.end(), door->ownedWorld) == worlds.end() ||
+			doorNodes.find(door) != doorNodes.end())
+			continue;
+
+		Node node;
+		node.world = door->ownedWorld;
+		node.door = door;
+		node.position = sf::Vector2f(door->localTilePos.x + 0.5f, door->localTilePos.y + 0.5f);
+		node.region = node.world->getNavigationMesh().findRegion(node.position);
+
+		doorNodes[door] = static_cast<int>(nodes.size());
+		worldNodes[node.world].push_back(static_cast<int>(nodes.size()));
+		nodes.push_back(node);
+	}
+
+	std::vector<std::vector<Edge>> adjacency(nodes.size());
+
+	// walking distance between every pair of doors in the same world
+	std::vector<sf::Vector2f> positions;
+	std::vector<float> distances;
+	for (auto &pair : worldNodes)
+	{
+		const std::vector<int> &worldDoors = pair.second;
+
+		positions.clear();
+		for (int node : worldDoors)
+			positions.push_back(nodes[node].position);
+
+		getDoorDistances(pair.first, positions, distances);
+
+		for (size_t i = 0; i < worldDoors.size(); ++i)
+		{
+			for (size_t j = 0; j < worldDoors.size(); ++j)
+			{
+				float distance = distances[i * worldDoors.size() + j];
+				if (i != j && distance >= 0.f)
+					adjacency[worldDoors[i]].push_back({worldDoors[j], distance});
+			}
+		}
+	}
+
+	// through doors to their partners
+	for (Building *building : buildings)
+	{
+		doors.clear();
+		building->getDoors(doors);
+
+		for (Door *door : doors)
+		{
+			auto from = doorNodes.find(door);
+			auto to = doorNodes.find(building->getConnectedDoor(door));
+			if (from == doorNodes.end() || to == doorNodes.end())
+				continue;
+
+			adjacency[from->second].push_back({to->second, doorCost});
+		}
+	}
+
+	// flatten
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		nodes[i].firstEdge = static_cast<unsigned>(edges.size());
+		nodes[i].edgeCount = static_cast<unsigned>(adjacency[i].size());
+		edges.insert(edges.end(), adjacency[i].begin(), adjacency[i].end());
+	}
+
+	Logger::logDebug(format("Built portal graph with %1% doors and %2% edges across %3% worlds",
+							_str(nodes.size()), _str(edges.size()), _str(worlds.size())));
+}
+
+bool PortalGraph::findRoute(World *startWorld, const sf::Vector2f &start, World *endWorld, const sf::Vector2f &end,
+							std::vector<RouteLeg> &route) const
+{
+	route.clear();
+
+	int startRegion = startWorld->getNavigationMesh().findRegion(start);
+	int endRegion = endWorld->getNavigationMesh().findRegion(end);
+	if (startRegion == -1 || endRegion == -1)
+		return false;
+
+	const float infinity = std::numeric_limits<float>::max();
+	float best = infinity;
+	int bestNode = -1;
+
+	// straight there
+	if (startWorld == endWorld && startRegion == endRegion)
+		best = Math::distance(start, end);
+
+	auto startDoors = worldNodes.find(startWorld);
+	auto endDoors = worldNodes.find(endWorld);
+
+	if (startDoors != worldNodes.end() && endDoors != worldNodes.end())
+	{
+		// the doors in the final world that can reach the end
+		std::unordered_map<int, float> finalCosts;
+		for (int node : endDoors->second)
+		{
+			if (nodes[node].region == endRegion)
+				finalCosts[node] = Math::distance(nodes[node].position, end);
+		}
+
+		// dijkstra from every door in the first world that the start can reach
+		std::vector<float> costs(nodes.size(), infinity);
+		std::vector<int> cameFrom(nodes.size(), -1);
+
+		typedef std::pair<float, int> OpenNode;
+		std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> open;
+
+		for (int node : startDoors->second)
+		{
+			if (nodes[node].region != startRegion)
+				continue;
+
+			float distance = Math::distance(start, nodes[node].position);
+			costs[node] = distance;
+			open.push({distance, node});
+		}
+
+		while (!open.empty())
+		{
+			float cost = open.top().first;
+			int current = open.top().second;
+			open.pop();
+
+			// stale, or can't beat the best so far
+			if (cost > costs[current])
+				continue;
+			if (cost >= best)
+				break;
+
+			auto finalCost = finalCosts.find(current);
+			if (finalCost != finalCosts.end() && cost + finalCost->second < best)
+			{
+				best = cost + finalCost->second;
+				bestNode = current;
+			}
+
+			const Node &node = nodes[current];
+			for (unsigned e = node.firstEdge; e < node.firstEdge + node.edgeCount; ++e)
+			{
+				const Edge &edge = edges[e];
+				float newCost = cost + edge.cost;
+
+				if (newCost < costs[edge.target])
+				{
+					costs[edge.target] = newCost;
+					cameFrom[edge.target] = current;
+					open.push({newCost, edge.target});
+				}
+			}
+		}
+
+		// walk back through the doors
+		if (bestNode != -1)
+		{
+			std::vector<int> doors;
+			for (int node = bestNode; node != -1; node = cameFrom[node])
+				doors.push_back(node);
+
+			World *world = startWorld;
+			sf::Vector2f position(start);
+
+			for (auto it = doors.rbegin(); it != doors.rend(); ++it)
+			{
+				const Node &door = nodes[*it];
+
+				// walk to the door, or come out of its partner in another world
+				if (door.world == world)
+					route.emplace_back(world, position, door.position);
+
+				world = door.world;
+				position = door.position;
+			}
+
+			route.emplace_back(world, position, end);
+			return true;
+		}
+	}
+
+	if (best == infinity)
+		return false;
+
+	route.emplace_back(startWorld, start, end);
+	return true;
+}
+
+void PortalGraph::getDoorDistances(World *world, const std::vector<sf::Vector2f> &doors,
+								   std::vector<float> &distances) const
+{
+	const std::string &worldPath = world->getFilePath();
+	std::string cachePath(worldPath + ".doors");
+	bool useCache = !worldPath.empty() && Config::getBool("world.navigation-cache", true);
+
+	if (useCache && Serialization::isUpToDate(cachePath, worldPath) && loadDistances(cachePath, doors, distances))
+		return;
+
+	const NavigationMesh &nav = world->getNavigationMesh();
+	distances.assign(doors.size() * doors.size(), -1.f);
+
+	for (size_t i = 0; i < doors.size(); ++i)
+	{
+		distances[i * doors.size() + i] = 0.f;
+
+		for (size_t j = i + 1; j < doors.size(); ++j)
+		{
+			// can't walk between regions
+			int region = nav.findRegion(doors[i]);
+			if (region == -1 || region != nav.findRegion(doors[j]))
+				continue;
+
+			float distance = getWalkingDistance(world, doors[i], doors[j]);
+			distances[i * doors.size() + j] = distances[j * doors.size() + i] = distance;
+		}
+	}
+
+	if (useCache && !saveDistances(cachePath, doors, distances))
+		Logger::logWarning(format("Could not write door distance cache to %1%", cachePath));
+}
+
+bool PortalGraph::loadDistances(const std::string &path, const std::vector<sf::Vector2f> &doors,
+								std::vector<float> &distances)
+{
+	BinaryReader reader(path);
+	if (!reader.readHeader(doorCacheMagic, doorCacheVersion))
+		return false;
+
+	try
+	{
+		// the doors must be the same, in the same order
+		std::vector<sf::Vector2f> cachedDoors;
+		reader.readVector(cachedDoors);
+		if (cachedDoors != doors)
+			return false;
+
+		reader.readVector(distances);
+	} catch (std::runtime_error &e)
+	{
+		Logger::logWarning(format("Invalid door distance cache: %1%", e.what()));
+		return false;
+	}
+
+	return distances.size() == doors.size() * doors.size();
+}
+
+bool PortalGraph::saveDistances(const std::string &path, const std::vector<sf::Vector2f> &doors,
+								const std::vector<float> &distances)
+{
+	BinaryWriter writer(path);
+	writer.writeHeader(doorCacheMagic, doorCacheVersion);
+	writer.writeVector(doors);
+	writer.writeVector(distances);
+	return writer.good();
+}
+
+float PortalGraph::getWalkingDistance(World *world, const sf::Vector2f &start, const sf::Vector2f &end)
+{
+	std::vector<sf::Vector2f> path;
+	if (!world->getNavigationMesh().findPath(start, end, path))
+		return -1.f;
+
+	float distance = 0.f;
+	for (size_t i = 1; i < path.size(); ++i)
+		distance += Math::distance(path[i - 1], path[i]);
+
+	return distance;
+}
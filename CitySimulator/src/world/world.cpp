@@ -1,5 +1,6 @@
 #include "world.hpp"
 #include "bodydata.hpp"
+#include "serialization.hpp"
 #include "service/locator.hpp"
 
 WorldService::WorldService(const std::string &worldPath, const std::string &tilesetPath)
@@ -12,6 +13,8 @@ void WorldService::onEnable()
 	std::vector<std::string> worldsToLoad;
 	world.loadFromFile(worldPath, tilesetPath, worldsToLoad);
 	// todo clear worldsToLoad and keep loading until it's empty
+
+	portalGraph.build({&world});
 }
 
 void WorldService::onDisable()
@@ -24,6 +27,11 @@ World &WorldService::getWorld()
 	return world;
 }
 
+const PortalGraph &WorldService::getPortalGraph() const
+{
+	return portalGraph;
+}
+
 bool isCollidable(BlockType blockType)
 {
 	static const std::set<BlockType> collidables(
@@ -68,7 +76,7 @@ bool isOverLayer(const LayerType &layerType)
 	return layerType == LAYER_OVERTERRAIN;
 }
 
-World::World() : terrain(this), collisionMap(this), buildingMap(this)
+World::World() : terrain(this), collisionMap(this), buildingMap(this), navigationMesh(this)
 {
 	transform.scale(Constants::tileSizef, Constants::tileSizef);
 }
@@ -80,23 +88,42 @@ void World::loadFromFile(const std::string &filename,
 	Logger::pushIndent();
 
 	std::string path(Utils::joinPaths(Config::getResource("world.root"), filename));
-	TMX::TileMap *tmx = TMX::TileMap::load(path);
-
-	// failure
-	if (tmx == nullptr)
-		throw std::runtime_error("Could not load world from null TileMap");
-
-	sf::Vector2i size(tmx->width, tmx->height);
-	resize(size);
+	std::string compiledPath(getCompiledPath(path));
+	filePath = path;
+	CompiledWorld compiled;
+
+	// prefer the compiled world if it's up to date
+	if (Config::getBool("world.use-compiled", true) && Serialization::isUpToDate(compiledPath, path) &&
+		compiled.open(compiledPath))
+	{
+		Logger::logDebug(format("Loaded compiled world from %1%", compiledPath));
+	}
+	else
+	{
+		std::unique_ptr<TMX::TileMap> tmx(TMX::TileMap::load(path));
+		compiled.compile(*tmx);
+	}
+
+	resize(compiled.getTileSize());
 
 	// terrain
-	terrain.load(tmx, tileset);
-	buildingMap.load(*tmx, worldsToLoad);
-	collisionMap.load();
+	terrain.load(compiled, tileset);
+	buildingMap.load(compiled, worldsToLoad);
+	collisionMap.load(compiled);
+	navigationMesh.load(path);
 
 	Logger::popIndent();
 	Logger::logInfo(format("Loaded world %1%", filename));
-	delete tmx;
+}
+
+std::string World::getCompiledPath(const std::string &mapPath)
+{
+	return mapPath + ".csw";
+}
+
+const std::string &World::getFilePath() const
+{
+	return filePath;
 }
 
 void World::resize(sf::Vector2i size)
@@ -120,6 +147,11 @@ BuildingMap &World::getBuildingMap()
 	return buildingMap;
 }
 
+NavigationMesh &World::getNavigationMesh()
+{
+	return navigationMesh;
+}
+
 b2World *World::getBox2DWorld()
 {
 	return &collisionMap.world;
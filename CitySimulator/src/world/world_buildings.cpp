@@ -3,43 +3,9 @@
 #include "service/logging_service.hpp"
 
 
-void BuildingMap::gatherBuildings(TMX::Layer *buildingLayer)
+void BuildingMap::compile(const TMX::TileMap &tileMap, std::vector<CompiledWorld::Building> &buildings,
+						  std::vector<CompiledWorld::Door> &doors, std::string &strings)
 {
-	for (TMX::Tile *tile : buildingLayer->items)
-	{
-		if (tile->getTileType() != TMX::TILE_PROPERTY_SHAPE)
-			continue;
-
-		TMX::PropertyObject *propObj = dynamic_cast<TMX::PropertyObject *>(tile);
-
-		if (!propObj->hasProperty(TMX::PROPERTY_BUILDING_WORLD))
-			continue;
-
-		std::string buildingWorld(propObj->getProperty(TMX::PROPERTY_BUILDING_WORLD));
-		int buildingID = boost::lexical_cast<int>(propObj->getProperty(TMX::PROPERTY_BUILDING_ID));
-
-		sf::IntRect bounds(
-				(int) (propObj->position.x / Constants::tilesetResolution),
-				(int) (propObj->position.y / Constants::tilesetResolution),
-				(int) (propObj->dimensions.x / Constants::tilesetResolution),
-				(int) (propObj->dimensions.y / Constants::tilesetResolution)
-		);
-
-
-		Building b(*container, bounds, buildingID, buildingWorld);
-		buildings.insert({buildingID, b});
-
-		Logger::logDebuggiest(format("Found building %1% at (%2%, %3%)",
-									 _str(buildingID), _str(bounds.left), _str(bounds.top)));
-	}
-}
-
-
-void BuildingMap::load(const TMX::TileMap &tileMap, std::vector<std::string> &worldsToLoad)
-{
-	Logger::logDebug("Loading buildings");
-	Logger::pushIndent();
-
 	auto buildingLayer = std::find_if(tileMap.layers.begin(), tileMap.layers.end(),
 									  [](const TMX::Layer *layer)
 									  {
@@ -48,43 +14,71 @@ void BuildingMap::load(const TMX::TileMap &tileMap, std::vector<std::string> &wo
 
 	if (buildingLayer == tileMap.layers.end())
 	{
-		Logger::logWarning("No \"buildings\" layer was found in BuildingMap::load");
-		Logger::popIndent();
+		Logger::logWarning("No \"buildings\" layer was found in BuildingMap::compile");
 		return;
 	}
 
-	TMX::Layer *layer = *buildingLayer;
-
-	gatherBuildings(layer);
-
-	// entrances
-	for (TMX::Tile *tile : layer->items)
+	for (const TMX::PropertyObject &propObj : (*buildingLayer)->shapes)
 	{
-		if (tile->getTileType() != TMX::TILE_PROPERTY_SHAPE)
-			continue;
-
-		TMX::PropertyObject *propObj = dynamic_cast<TMX::PropertyObject *>(tile);
+		// building
+		if (propObj.hasProperty(TMX::PROPERTY_BUILDING_WORLD))
+		{
+			std::string buildingWorld(propObj.getProperty(TMX::PROPERTY_BUILDING_WORLD));
+
+			CompiledWorld::Building building;
+			building.id = boost::lexical_cast<int>(propObj.getProperty(TMX::PROPERTY_BUILDING_ID));
+			building.bounds = sf::IntRect(
+					(int) (propObj.position.x / Constants::tilesetResolution),
+					(int) (propObj.position.y / Constants::tilesetResolution),
+					(int) (propObj.dimensions.x / Constants::tilesetResolution),
+					(int) (propObj.dimensions.y / Constants::tilesetResolution)
+			);
+			building.worldName = static_cast<uint32_t>(strings.size());
+			building.worldNameLength = static_cast<uint32_t>(buildingWorld.size());
+
+			strings += buildingWorld;
+			buildings.push_back(building);
+		}
 
-		if (!propObj->hasProperty(TMX::PROPERTY_BUILDING_DOOR))
-			continue;
+		// entrance
+		if (propObj.hasProperty(TMX::PROPERTY_BUILDING_DOOR))
+		{
+			CompiledWorld::Door door;
+			door.buildingID = boost::lexical_cast<int>(propObj.getProperty(TMX::PROPERTY_BUILDING_ID));
+			door.doorID = boost::lexical_cast<int>(propObj.getProperty(TMX::PROPERTY_BUILDING_DOOR));
+			door.tile = (sf::Vector2i) Math::multiply(propObj.position, 1.f / Constants::tilesetResolution);
 
+			doors.push_back(door);
+		}
+	}
+}
 
-		int buildingID = boost::lexical_cast<int>(propObj->getProperty(TMX::PROPERTY_BUILDING_ID));
-		int doorID = boost::lexical_cast<int>(propObj->getProperty(TMX::PROPERTY_BUILDING_DOOR));
+void BuildingMap::load(const CompiledWorld &compiled, std::vector<std::string> &worldsToLoad)
+{
+	Logger::logDebug("Loading buildings");
+	Logger::pushIndent();
 
-		sf::Vector2i doorPos = (sf::Vector2i) Math::multiply(propObj->position, 1.f / Constants::tilesetResolution);
+	for (const CompiledWorld::Building &building : compiled.getBuildings())
+	{
+		addBuilding(building.id, building.bounds, compiled.getString(building.worldName, building.worldNameLength));
 
+		Logger::logDebuggiest(format("Found building %1% at (%2%, %3%)",
+									 _str(building.id), _str(building.bounds.left), _str(building.bounds.top)));
+	}
 
-		auto bFind = buildings.find(buildingID);
+	// entrances
+	for (const CompiledWorld::Door &door : compiled.getDoors())
+	{
+		auto bFind = buildings.find(door.buildingID);
 		if (bFind == buildings.end())
 		{
 			Logger::logWarning(format("Entrance at (%1%, %2%) has an unknown building ID %3%",
-									  _str(doorPos.x), _str(doorPos.y), _str(buildingID)));
+									  _str(door.tile.x), _str(door.tile.y), _str(door.buildingID)));
 			continue;
 		}
 
-		bFind->second.addDoor(doorID, doorPos, container);
-		Logger::logDebuggiest(format("Found door %1% to building %2%", _str(doorID), _str(buildingID)));
+		bFind->second.addDoor(door.doorID, door.tile, container);
+		Logger::logDebuggiest(format("Found door %1% to building %2%", _str(door.doorID), _str(door.buildingID)));
 	}
 
 	// windows
@@ -113,8 +107,20 @@ void BuildingMap::getBuildingByOutsideDoorTile(const sf::Vector2i &tile,
 	Logger::logWarning(format("Could not find building from door at (%1%, %2%)", _str(tile.x), _str(tile.y)));
 }
 
+Building &BuildingMap::addBuilding(int id, const sf::IntRect &tileBounds, const std::string &insideWorldName)
+{
+	buildings.erase(id);
+	return buildings.insert({id, Building(*container, tileBounds, id, insideWorldName)}).first->second;
+}
+
 Building *BuildingMap::getBuildingByID(int id)
 {
 	auto it = buildings.find(id);
 	return it == buildings.end() ? nullptr : &it->second;
 }
+
+void BuildingMap::getBuildings(std::vector<Building *> &out)
+{
+	for (auto &pair : buildings)
+		out.push_back(&pair.second);
+}
@@ -2,17 +2,31 @@
 #include "service/render_service.hpp"
 #include "service/locator.hpp"
 
-void CollisionMap::findCollidableTiles(std::vector<CollisionRect> &rects) const
+void CollisionMap::compile(const sf::Vector2i &tileSize, const std::vector<BlockType> &terrain,
+						   const std::vector<WorldObject> &objects, std::vector<CompiledWorld::CollisionRect> &out)
 {
-	sf::Vector2i worldTileSize = container->getTileSize();
+	std::vector<CollisionRect> rects;
+
+	// gather all collidable tiles
+	findCollidableTiles(tileSize, terrain, objects, rects);
+
+	// merge adjacents
+	mergeAdjacentTiles(rects);
+
+	for (const CollisionRect &rect : rects)
+		out.push_back({rect.rect, rect.rotation, rect.blockType});
+}
 
+void CollisionMap::findCollidableTiles(const sf::Vector2i &tileSize, const std::vector<BlockType> &terrain,
+									   const std::vector<WorldObject> &objects, std::vector<CollisionRect> &rects)
+{
 	// find collidable tiles
 	sf::Vector2f size(Constants::tileSizef, Constants::tileSizef); // todo: assuming all tiles are the same size
-	for (auto y = 0; y < worldTileSize.y; ++y)
+	for (auto y = 0; y < tileSize.y; ++y)
 	{
-		for (auto x = 0; x < worldTileSize.x; ++x)
+		for (auto x = 0; x < tileSize.x; ++x)
 		{
-			BlockType bt = container->getBlockAt({x, y}, LAYER_TERRAIN); // the only collidable tile layer
+			BlockType bt = terrain[y * tileSize.x + x]; // the only collidable tile layer
 			bool collide = isCollidable(bt);
 			bool interact = isInteractable(bt);
 
@@ -25,7 +39,6 @@ void CollisionMap::findCollidableTiles(std::vector<CollisionRect> &rects) const
 	}
 
 	// objects
-	auto objects = container->getTerrain().getObjects();
 	for (auto &obj : objects)
 	{
 		auto pos = obj.tilePos;
@@ -58,7 +71,7 @@ bool compareRectsVertically(const sf::FloatRect &a, const sf::FloatRect &b)
 	return false;
 }
 
-void CollisionMap::mergeAdjacentTiles(std::vector<CollisionRect> &rects, std::vector<sf::FloatRect> &ret)
+void CollisionMap::mergeAdjacentTiles(std::vector<CollisionRect> &rects)
 {
 	std::vector<sf::FloatRect> rectangles;
 
@@ -171,6 +184,17 @@ void CollisionMap::getSurroundingTiles(const sf::Vector2i &tilePos, std::set<sf:
 	}
 }
 
+const std::vector<sf::FloatRect> &CollisionMap::getBlockingRects() const
+{
+	return blockingRects;
+}
+
+void CollisionMap::renderDebug()
+{
+	if (b2Renderer)
+		b2Renderer->DrawVisible(world);
+}
+
 bool CollisionMap::getRectAt(const sf::Vector2i &tilePos, sf::FloatRect &ret)
 {
 	auto result(cellGrid.find(Utils::toPixel(tilePos)));
@@ -181,23 +205,36 @@ bool CollisionMap::getRectAt(const sf::Vector2i &tilePos, sf::FloatRect &ret)
 	return true;
 }
 
-void CollisionMap::load()
+void CollisionMap::load(const CompiledWorld &compiled)
 {
+	// already found and merged when compiled
 	std::vector<CollisionRect> rects;
-	std::vector<sf::FloatRect> mergedRects;
+	for (const CompiledWorld::CollisionRect &rect : compiled.getCollisionRects())
+		rects.emplace_back(rect.rect, rect.rotation, static_cast<BlockType>(rect.blockType));
 
-	// gather all collidable tiles
-	findCollidableTiles(rects);
+	// remember the solid ones for navigation
+	blockingRects.clear();
+	for (auto &collisionRect : rects)
+	{
+		if (isInteractable(collisionRect.blockType))
+			continue;
 
-	// merge adjacents
-	mergeAdjacentTiles(rects, mergedRects);
+		sf::FloatRect bounds(collisionRect.rect);
+		if (collisionRect.rotation != 0.f)
+		{
+			sf::Transform transform;
+			transform.rotate(collisionRect.rotation, bounds.left, bounds.top + bounds.height);
+			bounds = transform.transformRect(bounds);
+		}
+
+		blockingRects.push_back(bounds);
+	}
 
 	// debug drawing
-	sf::RenderWindow *window = Locator::locate<RenderService>()->getWindow();
-	if (Config::getBool("debug.render-physics", false) && window != nullptr)
+	sf::RenderTarget *target = Locator::locate<RenderService>()->getTarget();
+	if (Config::getBool("debug.render-physics", false) && target != nullptr)
 	{
-		b2Renderer.emplace(*window);
-		world.SetDebugDraw(&*b2Renderer);
+		b2Renderer.emplace(*target);
 		b2Renderer->SetFlags(b2Draw::e_shapeBit);
 	}
 
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include "world.hpp"
+#include "serialization.hpp"
+#include "service/locator.hpp"
+
+const std::string navigationCacheMagic("CSNAV");
+const uint32_t navigationCacheVersion = 1;
+
+/**
+ * Twice the signed area of the given triangle
+ */
+float triangleArea2(const sf::Vector2f &a, const sf::Vector2f &b, const sf::Vector2f &c)
+{
+	return (c.x - a.x) * (b.y - a.y) - (b.x - a.x) * (c.y - a.y);
+}
+
+void NavigationMesh::load(const std::string &worldPath)
+{
+	std::string cachePath(worldPath + ".nav");
+	bool useCache = Config::getBool("world.navigation-cache", true);
+	sf::Vector2i worldSize(container->getTileSize());
+
+	if (useCache && Serialization::isUpToDate(cachePath, worldPath) && loadCache(cachePath, worldSize))
+	{
+		Logger::logDebug(format("Loaded navigation mesh from %1%", cachePath));
+		return;
+	}
+
+	// block every tile whose centre is inside a collision rect
+	std::vector<bool> blocked(worldSize.x * worldSize.y, false);
+	for (const sf::FloatRect &rect : container->getCollisionMap().getBlockingRects())
+	{
+		sf::FloatRect tiles(rect.left / Constants::tileSizef, rect.top / Constants::tileSizef,
+							rect.width / Constants::tileSizef, rect.height / Constants::tileSizef);
+
+		int minX = std::max(0, static_cast<int>(std::ceil(tiles.left - 0.5f)));
+		int minY = std::max(0, static_cast<int>(std::ceil(tiles.top - 0.5f)));
+		int maxX = std::min(worldSize.x, static_cast<int>(std::ceil(tiles.left + tiles.width - 0.5f)));
+		int maxY = std::min(worldSize.y, static_cast<int>(std::ceil(tiles.top + tiles.height - 0.5f)));
+
+		for (int y = minY; y < maxY; ++y)
+			for (int x = minX; x < maxX; ++x)
+				blocked[y * worldSize.x + x] = true;
+	}
+
+	generate(worldSize, blocked);
+	Logger::logDebug(format("Generated navigation mesh with %1% polygons and %2% portals",
+							_str(polygons.size()), _str(getPortalCount())));
+
+	if (useCache && !save(cachePath))
+		Logger::logWarning(format("Could not write navigation mesh cache to %1%", cachePath));
+}
+
+void NavigationMesh::generate(const sf::Vector2i &size, const std::vector<bool> &blocked)
+{
+	if (blocked.size() != static_cast<size_t>(size.x * size.y))
+		error("Expected %1% tiles for the navigation mesh, but got %2%", _str(size.x * size.y), _str(blocked.size()));
+
+	this->size = size;
+	polygons.clear();
+	polygonGrid.assign(blocked.size(), -1);
+
+	auto isFree = [&](int x, int y)
+	{
+		int index = y * size.x + x;
+		return !blocked[index] && polygonGrid[index] == -1;
+	};
+
+	// greedily cover the walkable tiles with the largest rectangles possible
+	for (int y = 0; y < size.y; ++y)
+	{
+		for (int x = 0; x < size.x; ++x)
+		{
+			if (!isFree(x, y))
+				continue;
+
+			int width = 1;
+			while (x + width < size.x && isFree(x + width, y))
+				++width;
+
+			int height = 1;
+			while (y + height < size.y)
+			{
+				bool rowFree = true;
+				for (int dx = 0; dx < width && rowFree; ++dx)
+					rowFree = isFree(x + dx, y + height);
+
+				if (!rowFree)
+					break;
+				++height;
+			}
+
+			Polygon polygon;
+			polygon.bounds = sf::IntRect(x, y, width, height);
+			polygons.push_back(polygon);
+
+			fillGrid(static_cast<int>(polygons.size()) - 1);
+		}
+	}
+
+	findPortals();
+	findRegions();
+}
+
+void NavigationMesh::fillGrid(int index)
+{
+	const sf::IntRect &bounds = polygons[index].bounds;
+
+	for (int y = bounds.top; y < bounds.top + bounds.height; ++y)
+		std::fill_n(polygonGrid.begin() + y * size.x + bounds.left, bounds.width, index);
+}
+
+void NavigationMesh::findPortals()
+{
+	portals.clear();
+
+	for (Polygon &polygon : polygons)
+	{
+		polygon.firstPortal = static_cast<unsigned>(portals.size());
+
+		const sf::IntRect &b = polygon.bounds;
+		int right = b.left + b.width;
+		int bottom = b.top + b.height;
+
+		// walk along the outside of each side, splitting into a portal per neighbour
+		auto walkSide = [&](int fixed, bool horizontal, int outside, int from, int to)
+		{
+			if (outside < 0 || outside >= (horizontal ? size.y : size.x))
+				return;
+
+			int current = -1;
+			int runStart = from;
+
+			for (int i = from; i <= to; ++i)
+			{
+				int neighbour = -1;
+				if (i < to)
+					neighbour = horizontal ? polygonGrid[outside * size.x + i] : polygonGrid[i * size.x + outside];
+
+				if (neighbour == current)
+					continue;
+
+				if (current != -1)
+				{
+					Portal portal;
+					portal.neighbour = current;
+					portal.start = horizontal ? sf::Vector2f(runStart, fixed) : sf::Vector2f(fixed, runStart);
+					portal.end = horizontal ? sf::Vector2f(i, fixed) : sf::Vector2f(fixed, i);
+					portals.push_back(portal);
+				}
+
+				current = neighbour;
+				runStart = i;
+			}
+		};
+
+		walkSide(b.top, true, b.top - 1, b.left, right);
+		walkSide(bottom, true, bottom, b.left, right);
+		walkSide(b.left, false, b.left - 1, b.top, bottom);
+		walkSide(right, false, right, b.top, bottom);
+
+		polygon.portalCount = static_cast<unsigned>(portals.size()) - polygon.firstPortal;
+	}
+}
+
+void NavigationMesh::findRegions()
+{
+	regions.assign(polygons.size(), -1);
+	std::vector<int> open;
+	int region = 0;
+
+	// flood fill through the portals
+	for (size_t i = 0; i < polygons.size(); ++i)
+	{
+		if (regions[i] != -1)
+			continue;
+
+		regions[i] = region;
+		open.push_back(static_cast<int>(i));
+
+		while (!open.empty())
+		{
+			const Polygon &polygon = polygons[open.back()];
+			open.pop_back();
+
+			for (unsigned p = polygon.firstPortal; p < polygon.firstPortal + polygon.portalCount; ++p)
+			{
+				int neighbour = portals[p].neighbour;
+				if (regions[neighbour] == -1)
+				{
+					regions[neighbour] = region;
+					open.push_back(neighbour);
+				}
+			}
+		}
+
+		++region;
+	}
+}
+
+int NavigationMesh::findRegion(const sf::Vector2f &tilePos) const
+{
+	int polygon = findPolygon(tilePos);
+	return polygon == -1 ? -1 : regions[polygon];
+}
+
+int NavigationMesh::findPolygon(const sf::Vector2f &tilePos) const
+{
+	int x = static_cast<int>(std::floor(tilePos.x));
+	int y = static_cast<int>(std::floor(tilePos.y));
+
+	if (x < 0 || y < 0 || x >= size.x || y >= size.y)
+		return -1;
+
+	return polygonGrid[y * size.x + x];
+}
+
+bool NavigationMesh::findPath(const sf::Vector2f &start, const sf::Vector2f &end, std::vector<sf::Vector2f> &path,
+							  float clearance) const
+{
+	path.clear();
+
+	int startPolygon = findPolygon(start);
+	int endPolygon = findPolygon(end);
+	if (startPolygon == -1 || endPolygon == -1)
+		return false;
+
+	if (startPolygon == endPolygon)
+	{
+		path.push_back(start);
+		path.push_back(end);
+		return true;
+	}
+
+	// a* over polygons, entering each through the middle of a portal
+	const float infinity = std::numeric_limits<float>::max();
+	std::vector<float> costs(polygons.size(), infinity);
+	std::vector<int> cameFrom(polygons.size(), -1);
+	std::vector<unsigned> cameThrough(polygons.size(), 0);
+	std::vector<sf::Vector2f> entries(polygons.size());
+	std::vector<bool> closed(polygons.size(), false);
+
+	typedef std::pair<float, int> OpenPolygon;
+	std::priority_queue<OpenPolygon, std::vector<OpenPolygon>, std::greater<OpenPolygon>> open;
+
+	costs[startPolygon] = 0.f;
+	entries[startPolygon] = start;
+	open.push({Math::distance(start, end), startPolygon});
+
+	while (!open.empty())
+	{
+		int current = open.top().second;
+		open.pop();
+
+		if (closed[current])
+			continue;
+		closed[current] = true;
+
+		if (current == endPolygon)
+			break;
+
+		const Polygon &polygon = polygons[current];
+		for (unsigned p = polygon.firstPortal; p < polygon.firstPortal + polygon.portalCount; ++p)
+		{
+			const Portal &portal = portals[p];
+			if (closed[portal.neighbour])
+				continue;
+
+			sf::Vector2f middle((portal.start + portal.end) / 2.f);
+			float cost = costs[current] + Math::distance(entries[current], middle);
+
+			if (cost < costs[portal.neighbour])
+			{
+				costs[portal.neighbour] = cost;
+				entries[portal.neighbour] = middle;
+				cameFrom[portal.neighbour] = current;
+				cameThrough[portal.neighbour] = p;
+				open.push({cost + Math::distance(middle, end), portal.neighbour});
+			}
+		}
+	}
+
+	if (!closed[endPolygon])
+		return false;
+
+	// gather the portals along the way, as left and right points
+	std::vector<std::pair<sf::Vector2f, sf::Vector2f>> corridor;
+	corridor.push_back({end, end});
+
+	for (int polygon = endPolygon; cameFrom[polygon] != -1; polygon = cameFrom[polygon])
+	{
+		const Portal &portal = portals[cameThrough[polygon]];
+		sf::Vector2f along(portal.end - portal.start);
+		float length = Math::length(along);
+
+		// keep away from the corners
+		float inset = std::min(clearance, length / 2.f);
+		sf::Vector2f a(portal.start + along * (inset / length));
+		sf::Vector2f b(portal.end - along * (inset / length));
+
+		// orient relative to the direction of travel
+		const sf::IntRect &from = polygons[cameFrom[polygon]].bounds;
+		sf::Vector2f centre(from.left + from.width / 2.f, from.top + from.height / 2.f);
+
+		if (triangleArea2(centre, a, b) > 0.f)
+			corridor.push_back({a, b});
+		else
+			corridor.push_back({b, a});
+	}
+
+	corridor.push_back({start, start});
+	std::reverse(corridor.begin(), corridor.end());
+
+	funnel(corridor, path);
+	return true;
+}
+
+void NavigationMesh::funnel(const std::vector<std::pair<sf::Vector2f, sf::Vector2f>> &corridor,
+							std::vector<sf::Vector2f> &path) const
+{
+	// simple stupid funnel algorithm, from http://digestingduck.blogspot.co.uk/2010/03/simple-stupid-funnel-algorithm.html
+	sf::Vector2f apex(corridor[0].first);
+	sf::Vector2f left(corridor[0].first);
+	sf::Vector2f right(corridor[0].second);
+	size_t apexIndex = 0, leftIndex = 0, rightIndex = 0;
+
+	path.push_back(apex);
+
+	for (size_t i = 1; i < corridor.size(); ++i)
+	{
+		const sf::Vector2f &newLeft = corridor[i].first;
+		const sf::Vector2f &newRight = corridor[i].second;
+
+		// tighten the right side
+		if (triangleArea2(apex, right, newRight) <= 0.f)
+		{
+			if (apex == right || triangleArea2(apex, left, newRight) > 0.f)
+			{
+				right = newRight;
+				rightIndex = i;
+			}
+			else
+			{
+				// right crossed over left, so left is a corner
+				path.push_back(left);
+				apex = right = left;
+				apexIndex = rightIndex = leftIndex;
+				i = apexIndex;
+				continue;
+			}
+		}
+
+		// tighten the left side
+		if (triangleArea2(apex, left, newLeft) >= 0.f)
+		{
+			if (apex == left || triangleArea2(apex, right, newLeft) < 0.f)
+			{
+				left = newLeft;
+				leftIndex = i;
+			}
+			else
+			{
+				// left crossed over right, so right is a corner
+				path.push_back(right);
+				apex = left = right;
+				apexIndex = leftIndex = rightIndex;
+				i = apexIndex;
+				continue;
+			}
+		}
+	}
+
+	const sf::Vector2f &end = corridor.back().first;
+	if (path.back() != end)
+		path.push_back(end);
+}
+
+bool NavigationMesh::save(const std::string &path) const
+{
+	BinaryWriter writer(path);
+	writer.writeHeader(navigationCacheMagic, navigationCacheVersion);
+	writer.write(size);
+	writer.writeVector(polygons);
+	writer.writeVector(portals);
+	return writer.good();
+}
+
+bool NavigationMesh::loadCache(const std::string &path, const sf::Vector2i &expectedSize)
+{
+	BinaryReader reader(path);
+	if (!reader.readHeader(navigationCacheMagic, navigationCacheVersion))
+		return false;
+
+	try
+	{
+		if (reader.read<sf::Vector2i>() != expectedSize)
+			return false;
+
+		size = expectedSize;
+		reader.readVector(polygons);
+		reader.readVector(portals);
+	} catch (std::runtime_error &e)
+	{
+		Logger::logWarning(format("Invalid navigation mesh cache: %1%", e.what()));
+		polygons.clear();
+		portals.clear();
+		return false;
+	}
+
+	// everything must be in range before it is indexed
+	const char *invalid = nullptr;
+	for (const Polygon &polygon : polygons)
+	{
+		const sf::IntRect &bounds = polygon.bounds;
+		if (bounds.left < 0 || bounds.top < 0 || bounds.left + bounds.width > size.x ||
+			bounds.top + bounds.height > size.y)
+			invalid = "polygon out of bounds";
+		else if (polygon.firstPortal > portals.size() || polygon.portalCount > portals.size() - polygon.firstPortal)
+			invalid = "portals out of range";
+	}
+
+	for (const Portal &portal : portals)
+	{
+		if (portal.neighbour < 0 || static_cast<size_t>(portal.neighbour) >= polygons.size())
+			invalid = "portal neighbour out of range";
+	}
+
+	if (invalid != nullptr)
+	{
+		Logger::logWarning(format("Invalid navigation mesh cache: %1%", invalid));
+		polygons.clear();
+		portals.clear();
+		return false;
+	}
+
+	// rebuild lookup grid
+	polygonGrid.assign(size.x * size.y, -1);
+	for (size_t i = 0; i < polygons.size(); ++i)
+		fillGrid(static_cast<int>(i));
+
+	findRegions();
+	return true;
+}
@@ -1,10 +1,37 @@
+#include <algorithm>
+#include <future>
+#include <iomanip>
+#include <sstream>
+#include <boost/filesystem.hpp>
 #include <unordered_set>
 #include "world.hpp"
+#include "serialization.hpp"
 #include "utils.hpp"
-#include "service/logging_service.hpp"
-#include "service/render_service.hpp"
+#include "service/locator.hpp"
 
-Tileset::Tileset() : converted(false)
+const std::string tilesetCacheMagic("CSTILES");
+const uint32_t tilesetCacheVersion = 1;
+
+/**
+ * @return The hash as 16 hex digits, for use in file names
+ */
+std::string hashToString(uint64_t hash)
+{
+	std::ostringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return ss.str();
+}
+
+/**
+ * A flipped tile's position in the converted tileset
+ */
+struct CachedFlip
+{
+	int32_t flipGID;
+	int32_t blockType;
+};
+
+Tileset::Tileset() : image(nullptr), converted(false), cacheKey(0), fromCache(false)
 {
 }
 
@@ -27,19 +54,155 @@ void Tileset::load(const std::string &path)
 	generatePoints();
 }
 
-void Tileset::textureQuad(sf::Vertex *quad, const BlockType &blockType, int rotationAngle, int flipGID)
+void Tileset::loadConverted(const std::string &path, const std::vector<int> &flippedGIDs)
+{
+	prepare(path, flippedGIDs, Config::getBool("world.tileset-cache", true));
+	upload();
+}
+
+void Tileset::prepare(const std::string &path, const std::vector<int> &flippedGIDs, bool useCache)
+{
+	cachePath.clear();
+	fromCache = false;
+
+	// keyed by the tileset's contents and the flipped tiles, in order, so that every world using the tileset has its
+	// own cache
+	uint64_t imageKey;
+	if (useCache && Serialization::hashFile(path, imageKey))
+	{
+		cacheKey = Serialization::hash(flippedGIDs.data(), flippedGIDs.size() * sizeof(int), imageKey);
+		cachePath = path + "." + hashToString(imageKey) + "." + hashToString(cacheKey) + ".cache";
+
+		if (loadCache())
+		{
+			fromCache = true;
+			return;
+		}
+	}
+
+	load(path);
+	convertImage(flippedGIDs);
+
+	if (!cachePath.empty())
+		removeStaleCaches(path, imageKey);
+}
+
+void Tileset::removeStaleCaches(const std::string &path, uint64_t imageKey)
+{
+	namespace fs = boost::filesystem;
+
+	fs::path tileset(path);
+	std::string prefix(tileset.filename().string() + ".");
+	std::string current(prefix + hashToString(imageKey) + ".");
+	const std::string suffix(".cache");
+
+	boost::system::error_code error;
+	fs::path directory(tileset.has_parent_path() ? tileset.parent_path() : fs::path("."));
+	for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		std::string name(it->path().filename().string());
+		if (name.size() < prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+			name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0 ||
+			name.compare(0, current.size(), current) == 0)
+			continue;
+
+		// from an older version of the tileset
+		Logger::logDebug(format("Removing stale tileset cache %1%", it->path().string()));
+		fs::remove(it->path(), error);
+	}
+}
+
+void Tileset::upload()
+{
+	if (!texture.loadFromImage(atlas))
+		throw std::runtime_error("Could not render tileset");
+	texture.setSmooth(false);
+
+	if (fromCache)
+		Logger::logDebug(format("Loaded converted tileset from %1%", cachePath));
+
+	atlas = sf::Image();
+	converted = true;
+}
+
+bool Tileset::loadCache()
+{
+	BinaryReader reader(cachePath);
+	if (!reader.readHeader(tilesetCacheMagic, tilesetCacheVersion))
+		return false;
+
+	std::vector<CachedFlip> flips;
+
+	try
+	{
+		if (reader.read<uint64_t>() != cacheKey)
+			return false;
+
+		sf::Vector2u tileCount = reader.read<sf::Vector2u>();
+		sf::Vector2u pixelSize = reader.read<sf::Vector2u>();
+
+		std::vector<sf::Uint8> pixels;
+		reader.readVector(pixels);
+		reader.readVector(flips);
+
+		if (pixels.size() != pixelSize.x * pixelSize.y * 4)
+			error("Expected %1% bytes of pixels, but got %2%", _str(pixelSize.x * pixelSize.y * 4), _str(pixels.size()));
+
+		atlas.create(pixelSize.x, pixelSize.y, pixels.data());
+		size = tileCount;
+	} catch (std::runtime_error &e)
+	{
+		Logger::logWarning(format("Invalid tileset cache: %1%", e.what()));
+		return false;
+	}
+
+	generatePoints();
+	findOpaqueTiles();
+
+	flippedBlockTypes.clear();
+	for (const CachedFlip &flip : flips)
+		flippedBlockTypes.insert(std::make_pair(flip.flipGID, flip.blockType));
+
+	return true;
+}
+
+void Tileset::saveCache()
+{
+	std::vector<CachedFlip> flips;
+	for (const auto &pair : flippedBlockTypes)
+		flips.push_back({pair.first, pair.second});
+
+	sf::Vector2u pixelSize(atlas.getSize());
+	const sf::Uint8 *pixelsPtr = atlas.getPixelsPtr();
+	std::vector<sf::Uint8> pixels(pixelsPtr, pixelsPtr + pixelSize.x * pixelSize.y * 4);
+
+	BinaryWriter writer(cachePath);
+	writer.writeHeader(tilesetCacheMagic, tilesetCacheVersion);
+	writer.write(cacheKey);
+	writer.write(size);
+	writer.write(pixelSize);
+	writer.writeVector(pixels);
+	writer.writeVector(flips);
+
+	if (!writer.good())
+		Logger::logWarning(format("Could not write tileset cache to %1%", cachePath));
+}
+
+int Tileset::getBlockID(const BlockType &blockType, int flipGID) const
 {
-	int blockID;
 	auto flipResult = flippedBlockTypes.find(flipGID);
 
 	// not flipped
 	if (flipGID == 0 || flipResult == flippedBlockTypes.end())
-		blockID = blockType;
+		return blockType;
 
-		// flipped
-	else
-		blockID = flipResult->second;
+	// flipped
+	return flipResult->second;
+}
 
+void Tileset::textureQuad(sf::Vertex *quad, const BlockType &blockType, int rotationAngle, int flipGID)
+{
+	int blockID = getBlockID(blockType, flipGID);
 
 	int row = blockID % size.x;
 	int col = blockID / size.x;
@@ -57,6 +220,36 @@ void Tileset::textureQuad(sf::Vertex *quad, const BlockType &blockType, int rota
 	quad[(3 + offset) % 4].texCoords = points[getIndex(row, col + 1)];
 }
 
+bool Tileset::isOpaque(const BlockType &blockType, int flipGID) const
+{
+	unsigned blockID = static_cast<unsigned>(getBlockID(blockType, flipGID));
+	return blockID < opaqueTiles.size() && opaqueTiles[blockID];
+}
+
+void Tileset::findOpaqueTiles()
+{
+	const sf::Uint8 *pixels = atlas.getPixelsPtr();
+	const unsigned width = atlas.getSize().x;
+
+	opaqueTiles.assign(size.x * size.y, true);
+	for (unsigned blockID = 0; blockID < opaqueTiles.size(); ++blockID)
+	{
+		sf::IntRect rect = getTileRect(blockID);
+
+		for (int y = rect.top; y < rect.top + rect.height && opaqueTiles[blockID]; ++y)
+		{
+			for (int x = rect.left; x < rect.left + rect.width; ++x)
+			{
+				if (pixels[(x + y * width) * 4 + 3] != 255)
+				{
+					opaqueTiles[blockID] = false;
+					break;
+				}
+			}
+		}
+	}
+}
+
 sf::Texture *Tileset::getTexture() const
 {
 	if (!converted)
@@ -77,7 +270,7 @@ sf::Vector2u Tileset::getSize() const
 	return size;
 }
 
-void Tileset::convertToTexture(const std::vector<int> &flippedGIDs)
+void Tileset::convertImage(const std::vector<int> &flippedGIDs)
 {
 	// resize image
 	int totalBlockTypes = BLOCK_UNKNOWN + flippedGIDs.size();
@@ -87,9 +280,8 @@ void Tileset::convertToTexture(const std::vector<int> &flippedGIDs)
 		rowsRequired += 1;
 
 	// transfer to new image
-	sf::Image newImage;
-	newImage.create(size.x * Constants::tilesetResolution, rowsRequired * Constants::tilesetResolution);
-	newImage.copy(*image, 0, 0);
+	atlas.create(size.x * Constants::tilesetResolution, rowsRequired * Constants::tilesetResolution);
+	atlas.copy(*image, 0, 0);
 
 	// update size
 	size.y = rowsRequired;
@@ -115,7 +307,7 @@ void Tileset::convertToTexture(const std::vector<int> &flippedGIDs)
 
 		// copy to tileset
 		sf::IntRect rect = getTileRect(currentBlockType);
-		newImage.copy(flippedImage, rect.left, rect.top);
+		atlas.copy(flippedImage, rect.left, rect.top);
 
 		// remember this new blocktype
 		flippedBlockTypes.insert(std::make_pair(flippedGID, currentBlockType));
@@ -123,13 +315,13 @@ void Tileset::convertToTexture(const std::vector<int> &flippedGIDs)
 		++currentBlockType;
 	}
 
-	// write to texture
-	if (!texture.loadFromImage(newImage))
-		throw std::runtime_error("Could not render tileset");
-	texture.setSmooth(false);
+	findOpaqueTiles();
+
+	if (!cachePath.empty())
+		saveCache();
 
-	converted = true;
 	delete image;
+	image = nullptr;
 }
 
 sf::IntRect Tileset::getTileRect(unsigned blockType)
@@ -171,10 +363,9 @@ int Tileset::getIndex(int x, int y) const
 }
 
 
-WorldTerrain::WorldTerrain(World *container) : BaseWorld(container)
+WorldTerrain::WorldTerrain(World *container) : BaseWorld(container), chunkSize(1), detailThreshold(0.f),
+												detailLevels(0), bakesPerFrame(0)
 {
-	tileVertices.setPrimitiveType(sf::Quads);
-	overLayerVertices.setPrimitiveType(sf::Quads);
 }
 
 WorldTerrain::~WorldTerrain()
@@ -193,7 +384,8 @@ int WorldTerrain::getBlockIndex(const sf::Vector2i &pos, LayerType layerType)
 
 int WorldTerrain::getVertexIndex(const sf::Vector2i &pos, LayerType layerType)
 {
-	int index = (pos.x + pos.y * container->tileSize.x);
+	const sf::IntRect &bounds = getChunk(pos).bounds;
+	int index = (pos.x - bounds.left) + (pos.y - bounds.top) * bounds.width;
 	int depth = layers.at(layerType).depth;
 	if (isOverLayer(layerType))
 	{
@@ -201,12 +393,25 @@ int WorldTerrain::getVertexIndex(const sf::Vector2i &pos, LayerType layerType)
 		depth -= diff;
 	}
 
-	index += depth * container->tileSize.x * container->tileSize.y;
+	index += depth * bounds.width * bounds.height;
 	index *= 4;
 
 	return index;
 }
 
+int WorldTerrain::getChunkIndex(const sf::Vector2i &pos) const
+{
+	int x = std::min(std::max(pos.x, 0) / chunkSize, chunkCount.x - 1);
+	int y = std::min(std::max(pos.y, 0) / chunkSize, chunkCount.y - 1);
+
+	return x + y * chunkCount.x;
+}
+
+TerrainChunk &WorldTerrain::getChunk(const sf::Vector2i &pos)
+{
+	return chunks[getChunkIndex(pos)];
+}
+
 
 void WorldTerrain::rotateObject(sf::Vertex *quad, float degrees, const sf::Vector2f &pos)
 {
@@ -240,9 +445,68 @@ void WorldTerrain::positionVertices(sf::Vertex *quad, const sf::Vector2f &pos, i
 }
 
 
-sf::VertexArray &WorldTerrain::getVertices(const LayerType &layerType)
+sf::VertexArray &WorldTerrain::getVertices(const sf::Vector2i &pos, const LayerType &layerType)
+{
+	TerrainChunk &chunk = getChunk(pos);
+
+	if (layerType == LAYER_OBJECTS)
+		return chunk.objectVertices;
+
+	return isOverLayer(layerType) ? chunk.overLayerSlots : chunk.tileSlots;
+}
+
+std::vector<unsigned char> &WorldTerrain::getCoverage(const sf::Vector2i &pos, const LayerType &layerType)
 {
-	return isOverLayer(layerType) ? overLayerVertices : tileVertices;
+	TerrainChunk &chunk = getChunk(pos);
+	return isOverLayer(layerType) ? chunk.overLayerCoverage : chunk.tileCoverage;
+}
+
+void WorldTerrain::cullHiddenTiles(TerrainChunk &chunk)
+{
+	const int area = chunk.bounds.width * chunk.bounds.height;
+
+	auto cull = [area](const sf::VertexArray &slots, const std::vector<unsigned char> &coverage, int layerCount,
+					   sf::VertexArray &out)
+	{
+		out.clear();
+
+		for (int tile = 0; tile < area; ++tile)
+		{
+			// nothing beneath the topmost opaque tile can be seen
+			int bottom = 0;
+			for (int layer = layerCount - 1; layer > 0; --layer)
+			{
+				if (coverage[tile + layer * area] == TerrainChunk::COVERAGE_OPAQUE)
+				{
+					bottom = layer;
+					break;
+				}
+			}
+
+			// tiles don't overlap their neighbours, so only the order within each slot matters
+			for (int layer = bottom; layer < layerCount; ++layer)
+			{
+				int slot = tile + layer * area;
+				if (coverage[slot] == TerrainChunk::COVERAGE_EMPTY)
+					continue;
+
+				for (int i = 0; i < 4; ++i)
+					out.append(slots[slot * 4 + i]);
+			}
+		}
+	};
+
+	cull(chunk.tileSlots, chunk.tileCoverage, tileLayerCount - overLayerCount, chunk.tileVertices);
+	cull(chunk.overLayerSlots, chunk.overLayerCoverage, overLayerCount, chunk.overLayerVertices);
+}
+
+std::size_t WorldTerrain::getTileVertexCount() const
+{
+	std::size_t count = 0;
+	for (const TerrainChunk &chunk : chunks)
+		count += chunk.tileVertices.getVertexCount() + chunk.overLayerVertices.getVertexCount();
+
+	return count;
 }
 
 void WorldTerrain::resizeVertices()
@@ -252,8 +516,46 @@ void WorldTerrain::resizeVertices()
 
 	blockTypes.resize(tileLayerCount * sizeMultiplier);
 
-	tileVertices.resize((tileLayerCount - overLayerCount) * sizeMultiplier);
-	overLayerVertices.resize(overLayerCount * sizeMultiplier);
+	// split into chunks, with smaller chunks along the right and bottom edges
+	chunkSize = std::max(1, Config::getInt("world.chunk-size", 32));
+	chunkCount.x = (tilesetResolution.x + chunkSize - 1) / chunkSize;
+	chunkCount.y = (tilesetResolution.y + chunkSize - 1) / chunkSize;
+
+	chunks.clear();
+	chunks.reserve(chunkCount.x * chunkCount.y);
+
+	for (int y = 0; y < chunkCount.y; ++y)
+	{
+		for (int x = 0; x < chunkCount.x; ++x)
+		{
+			sf::IntRect bounds(x * chunkSize, y * chunkSize, chunkSize, chunkSize);
+			bounds.width = std::min(chunkSize, tilesetResolution.x - bounds.left);
+			bounds.height = std::min(chunkSize, tilesetResolution.y - bounds.top);
+
+			chunks.emplace_back(bounds);
+
+			TerrainChunk &chunk = chunks.back();
+			const int chunkMultiplier = bounds.width * bounds.height * 4;
+			chunk.tileSlots.resize((tileLayerCount - overLayerCount) * chunkMultiplier);
+			chunk.overLayerSlots.resize(overLayerCount * chunkMultiplier);
+			chunk.tileCoverage.assign((tileLayerCount - overLayerCount) * chunkMultiplier / 4,
+									  TerrainChunk::COVERAGE_EMPTY);
+			chunk.overLayerCoverage.assign(overLayerCount * chunkMultiplier / 4, TerrainChunk::COVERAGE_EMPTY);
+		}
+	}
+
+	// levels stop once a tile would be smaller than a pixel
+	int maxLevels = 0;
+	while ((Constants::tilesetResolution >> (maxLevels + 1)) > 0)
+		++maxLevels;
+
+	detailThreshold = Config::getFloat("world.lod.threshold", 8.f);
+	detailLevels = std::min(maxLevels, std::max(0, Config::getInt("world.lod.levels", 4)));
+	bakesPerFrame = std::max(1, Config::getInt("world.lod.bakes-per-frame", 4));
+
+	bakedChunks.clear();
+	bakedChunks.resize(chunks.size());
+	bakeTargets.clear();
 }
 
 void WorldTerrain::registerLayer(LayerType layerType, int depth)
@@ -265,16 +567,84 @@ void WorldTerrain::registerLayer(LayerType layerType, int depth)
 
 void WorldTerrain::setBlockType(const sf::Vector2i &pos, BlockType blockType, LayerType layer, int rotationAngle,
 								int flipGID)
+{
+	int blockIndex = getBlockIndex(pos, layer);
+	blockTypes[blockIndex] = blockType;
+
+	// only the latest change to each tile is written
+	PendingTile &pending = pendingTiles[blockIndex];
+	pending.pos = pos;
+	pending.blockType = blockType;
+	pending.layer = layer;
+	pending.rotationAngle = rotationAngle;
+	pending.flipGID = flipGID;
+	pending.chunk = getChunkIndex(pos);
+}
+
+int WorldTerrain::applyChanges()
+{
+	if (pendingTiles.empty())
+		return 0;
+
+	// group by chunk so each is only rebuilt once
+	std::vector<const PendingTile *> changes;
+	changes.reserve(pendingTiles.size());
+	for (const auto &pair : pendingTiles)
+		changes.push_back(&pair.second);
+
+	std::sort(changes.begin(), changes.end(), [](const PendingTile *a, const PendingTile *b)
+	{
+		return a->chunk < b->chunk;
+	});
+
+	int rebuilt = 0;
+	int lastChunk = -1;
+	for (const PendingTile *change : changes)
+	{
+		if (change->chunk != lastChunk)
+		{
+			++rebuilt;
+			++chunks[change->chunk].revision;
+			lastChunk = change->chunk;
+		}
+
+		writeTile(change->pos, change->blockType, change->layer, change->rotationAngle, change->flipGID);
+	}
+
+	lastChunk = -1;
+	for (const PendingTile *change : changes)
+	{
+		if (change->chunk != lastChunk)
+		{
+			cullHiddenTiles(chunks[change->chunk]);
+			lastChunk = change->chunk;
+		}
+	}
+
+	Logger::logDebuggiest(format("Rebuilt %1% terrain chunk(s) for %2% tile change(s)", _str(rebuilt),
+								 _str(pendingTiles.size())));
+
+	pendingTiles.clear();
+	return rebuilt;
+}
+
+void WorldTerrain::writeTile(const sf::Vector2i &pos, BlockType blockType, LayerType layer, int rotationAngle,
+							 int flipGID)
 {
 	int vertexIndex = getVertexIndex(pos, layer);
-	sf::VertexArray &vertices = getVertices(layer);
-	auto size = vertices.getVertexCount();
+	sf::VertexArray &vertices = getVertices(pos, layer);
 	sf::Vertex *quad = &vertices[vertexIndex];
 
 	positionVertices(quad, static_cast<sf::Vector2f>(pos), 1);
 	tileset.textureQuad(quad, blockType, rotationAngle, flipGID);
 
-	blockTypes[getBlockIndex(pos, layer)] = blockType;
+	TerrainChunk::Coverage coverage = TerrainChunk::COVERAGE_PARTIAL;
+	if (blockType == BLOCK_BLANK)
+		coverage = TerrainChunk::COVERAGE_EMPTY;
+	else if (tileset.isOpaque(blockType, flipGID))
+		coverage = TerrainChunk::COVERAGE_OPAQUE;
+
+	getCoverage(pos, layer)[vertexIndex / 4] = static_cast<unsigned char>(coverage);
 }
 
 void WorldTerrain::addObject(const sf::Vector2f &pos, BlockType blockType, float rotationAngle, int flipGID)
@@ -291,9 +661,11 @@ void WorldTerrain::addObject(const sf::Vector2f &pos, BlockType blockType, float
 	if (rotationAngle != 0)
 		rotateObject(&quad[0], rotationAngle, adjustedPos);
 
-	sf::VertexArray &vertices = getVertices(LAYER_OBJECTS);
+	sf::Vector2i chunkPos(static_cast<sf::Vector2i>(adjustedPos));
+	sf::VertexArray &vertices = getVertices(chunkPos, LAYER_OBJECTS);
 	for (int i = 0; i < 4; ++i)
 		vertices.append(quad[i]);
+	++getChunk(chunkPos).revision;
 
 	objects.emplace_back(blockType, rotationAngle, Utils::toTile(pos));
 }
@@ -308,152 +680,395 @@ const std::vector<WorldLayer> &WorldTerrain::getLayers()
 	return layers;
 }
 
-void WorldTerrain::discoverLayers(std::vector<TMX::Layer *> &layers, std::vector<LayerType> &layerTypes)
+void WorldTerrain::compile(const TMX::TileMap &tileMap, std::vector<CompiledWorld::Layer> &layers,
+						   std::vector<int32_t> &flippedGIDs, std::vector<TMX::rot> &tiles,
+						   std::vector<CompiledWorld::Object> &objects)
 {
-	auto layerIt = layers.begin();
+	const size_t tileCount = static_cast<size_t>(tileMap.width * tileMap.height);
+	std::vector<const TMX::Layer *> visibleLayers;
 	int depth(0);
-	tileLayerCount = 0;
-	overLayerCount = 0;
-	while (layerIt != layers.end())
-	{
-		auto layer = *layerIt;
 
+	for (const TMX::Layer *layer : tileMap.layers)
+	{
 		// unknown layer type
 		LayerType layerType = layerTypeFromString(layer->name);
 		if (layerType == LAYER_UNKNOWN)
 		{
 			Logger::logError("Invalid layer name: " + layer->name);
-			layerIt = layers.erase(layerIt);
 			continue;
 		}
 
 		// invisible layer
 		if (!layer->visible)
-		{
-			layerIt = layers.erase(layerIt);
 			continue;
-		}
+
+		layers.push_back({layerType, depth++});
+		visibleLayers.push_back(layer);
 
 		if (isTileLayer(layerType))
-			++tileLayerCount;
-		if (isOverLayer(layerType))
-			++overLayerCount;
+		{
+			if (layer->gids.size() < tileCount)
+				error("Expected %1% tiles in layer '%2%', but got %3%", _str(tileCount), layer->name,
+					  _str(layer->gids.size()));
 
-		// add layer
-		registerLayer(layerType, depth);
-		layerTypes.push_back(layerType);
+			tiles.insert(tiles.end(), layer->gids.begin(), layer->gids.begin() + tileCount);
+		}
 
-		++depth;
-		++layerIt;
+		else if (layerType == LAYER_OBJECTS)
+		{
+			for (const TMX::Object &object : layer->objects)
+			{
+				TMX::Tile tile(object.getTile());
+				if (tile.getGID() == BLOCK_BLANK)
+					continue;
+
+				CompiledWorld::Object compiled;
+				compiled.blockType = static_cast<int32_t>(tile.getGID());
+				compiled.flipGID = tile.getFlipGID();
+				compiled.rotation = object.rotationAnglef;
+				compiled.position = object.position;
+				objects.push_back(compiled);
+			}
+		}
 	}
+
+	discoverFlippedTiles(visibleLayers, flippedGIDs);
 }
 
-void WorldTerrain::discoverFlippedTiles(const std::vector<TMX::Layer *> &layers, std::vector<int> &flippedGIDs)
+void WorldTerrain::discoverFlippedTiles(const std::vector<const TMX::Layer *> &layers,
+										std::vector<int32_t> &flippedGIDs)
 {
 	std::unordered_set<int> flipped;
 
-	for (TMX::Layer *layer : layers)
+	auto addFlipped = [&](TMX::rot gid)
 	{
-		for (TMX::Tile *tile : layer->items)
-		{
-			// doesn't exist or isn't flipped
-			if (tile == nullptr || !tile->isFlipped())
-				continue;
+		// not flipped, so no need to decode
+		if (!TMX::isFlipped(gid))
+			return;
 
-			if (tile->getGID() == BLOCK_BLANK)
-				continue;
+		TMX::Tile tile(gid);
+		if (tile.getGID() == BLOCK_BLANK)
+			return;
 
-			int flipGID = tile->getFlipGID();
+		// already done
+		int flipGID = tile.getFlipGID();
+		if (!flipped.insert(flipGID).second)
+			return;
 
-			// already done
-			if (flipped.find(flipGID) != flipped.end())
-				continue;
+		flippedGIDs.push_back(flipGID);
+	};
 
-			flippedGIDs.push_back(flipGID);
-			flipped.insert(flipGID);
-		}
+	for (const TMX::Layer *layer : layers)
+	{
+		for (TMX::rot gid : layer->gids)
+			addFlipped(gid);
+
+		for (const TMX::Object &object : layer->objects)
+			addFlipped(object.gid);
 	}
 }
 
-void WorldTerrain::addTiles(const std::vector<TMX::Layer *> &layers, const std::vector<LayerType> &types)
+void WorldTerrain::addTiles(const CompiledWorld &compiled)
 {
 	sf::Vector2i tileSize = container->tileSize;
 	sf::Vector2i pos;
-	int layerIndex(0);
+	const TMX::rot *gid = compiled.getTiles().begin();
 
-	for (TMX::Layer *layer : layers)
+	for (const WorldLayer &layer : layers)
 	{
-		LayerType layerType = types[layerIndex++];
+		if (!isTileLayer(layer.type))
+			continue;
 
-		if (layerType == LAYER_OBJECTS)
+		// tiles, in one pass over the gids
+		for (pos.y = 0; pos.y < tileSize.y; ++pos.y)
 		{
-			// objects
-			for (TMX::Tile *item : layer->items)
+			for (pos.x = 0; pos.x < tileSize.x; ++pos.x, ++gid)
 			{
-				BlockType blockType = static_cast<BlockType>(item->getGID());
+				// blank, without decoding
+				if (*gid <= 1)
+					continue;
+
+				TMX::Tile tile(*gid);
+				BlockType blockType = static_cast<BlockType>(tile.getGID());
 				if (blockType == BLOCK_BLANK)
 					continue;
 
-				TMX::Object *object = dynamic_cast<TMX::Object *>(item);
-				addObject(object->position, blockType, object->rotationAnglef, item->getFlipGID());
+				// written straight away while loading
+				blockTypes[getBlockIndex(pos, layer.type)] = blockType;
+				writeTile(pos, blockType, layer.type, tile.getRotationAngle(), tile.getFlipGID());
 			}
 		}
+	}
 
-		else if (isTileLayer(layerType))
-		{
-			// tiles
-			for (int y = 0; y < tileSize.y; ++y)
-			{
-				for (int x = 0; x < tileSize.x; ++x)
-				{
-					TMX::Tile *tile = layer->items[x + y * tileSize.x];
-					if (tile == nullptr)
-						continue;
+	// objects
+	for (const CompiledWorld::Object &object : compiled.getObjects())
+		addObject(object.position, static_cast<BlockType>(object.blockType), object.rotation, object.flipGID);
+}
+
+void WorldTerrain::render(sf::RenderTarget &target, sf::RenderStates &states, bool overLayers) const
+{
+	if (chunks.empty())
+		return;
 
-					BlockType blockType = static_cast<BlockType>(tile->getGID());
-					if (blockType == BLOCK_BLANK)
-						continue;
+	states.texture = tileset.getTexture();
+
+	// visible area in tiles, with a tile of leeway for objects that stick out of their chunk
+	const sf::View &view = target.getView();
+	sf::FloatRect viewRect(view.getCenter() - view.getSize() / 2.f, view.getSize());
+	sf::FloatRect visible(states.transform.getInverse().transformRect(viewRect));
 
-					pos.x = x;
-					pos.y = y;
+	int minX = std::max(0, static_cast<int>(std::floor(visible.left - 1)) / chunkSize);
+	int minY = std::max(0, static_cast<int>(std::floor(visible.top - 1)) / chunkSize);
+	int maxX = std::min(chunkCount.x - 1, static_cast<int>(std::floor(visible.left + visible.width + 1)) / chunkSize);
+	int maxY = std::min(chunkCount.y - 1, static_cast<int>(std::floor(visible.top + visible.height + 1)) / chunkSize);
+
+	std::size_t drawCalls = 0;
+	std::size_t submitted = 0;
+	auto drawVertices = [&](const sf::VertexArray &vertices)
+	{
+		if (vertices.getVertexCount() == 0)
+			return;
 
-					setBlockType(pos, blockType, layerType, tile->getRotationAngle(), tile->getFlipGID());
+		target.draw(vertices, states);
+		++drawCalls;
+		submitted += vertices.getVertexCount();
+	};
+
+	auto drawChunks = [&](sf::VertexArray TerrainChunk::*vertices)
+	{
+		for (int y = minY; y <= maxY; ++y)
+			for (int x = minX; x <= maxX; ++x)
+				drawVertices(chunks[x + y * chunkCount.x].*vertices);
+	};
+
+	float pixelsPerTile = target.getSize().x * view.getViewport().width / std::max(visible.width, 1.f);
+	int level = getDetailLevel(pixelsPerTile);
+
+	if (level > 0)
+	{
+		// far out, so draw each chunk as a single downsampled image
+		int bakesLeft = bakesPerFrame;
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				int index = x + y * chunkCount.x;
+				const TerrainChunk &chunk = chunks[index];
+				const sf::Texture *texture = getBakedTexture(index, level, overLayers, bakesLeft);
+
+				// out of bakes for this frame, so fall back to the tiles until the next, or nothing to draw
+				if (texture == nullptr)
+				{
+					if (overLayers)
+						drawVertices(chunk.overLayerVertices);
+					else
+					{
+						drawVertices(chunk.tileVertices);
+						drawVertices(chunk.objectVertices);
+					}
+					continue;
 				}
+
+				// levels are the size of a whole chunk, so smaller chunks at the edge only use the corner
+				sf::IntRect textureRect(0, 0, (chunk.bounds.width * Constants::tilesetResolution) >> level,
+										(chunk.bounds.height * Constants::tilesetResolution) >> level);
+				sf::Sprite sprite(*texture, textureRect);
+				sprite.setPosition(chunk.bounds.left, chunk.bounds.top);
+				sprite.setScale(static_cast<float>(chunk.bounds.width) / textureRect.width,
+								static_cast<float>(chunk.bounds.height) / textureRect.height);
+
+				target.draw(sprite, states);
+				++drawCalls;
+				submitted += 4;
 			}
 		}
 	}
+
+	// objects are drawn over every chunk's tiles, as they can overlap neighbouring chunks
+	else if (overLayers)
+		drawChunks(&TerrainChunk::overLayerVertices);
+	else
+	{
+		drawChunks(&TerrainChunk::tileVertices);
+		drawChunks(&TerrainChunk::objectVertices);
+	}
+
+	RenderService *renderService = Locator::locate<RenderService>(false);
+	if (renderService != nullptr)
+		renderService->countDraws(drawCalls, submitted);
+}
+
+int WorldTerrain::getDetailLevel(float pixelsPerTile) const
+{
+	if (detailLevels == 0 || pixelsPerTile >= detailThreshold)
+		return 0;
+
+	// the smallest image that still has a texel for every pixel
+	int level = 1;
+	while (level < detailLevels && (Constants::tilesetResolution >> (level + 1)) >= pixelsPerTile)
+		++level;
+
+	return level;
+}
+
+const sf::Texture *WorldTerrain::getBakedTexture(int chunkIndex, int level, bool overLayers, int &bakesLeft) const
+{
+	const TerrainChunk &chunk = chunks[chunkIndex];
+	BakedChunk &baked = bakedChunks[chunkIndex];
+
+	// nothing to draw
+	if (overLayers && chunk.overLayerVertices.getVertexCount() == 0)
+		return nullptr;
+
+	if (!baked.baked || baked.revision != chunk.revision)
+	{
+		if (bakesLeft <= 0)
+			return nullptr;
+		--bakesLeft;
+
+		baked.baked = bakeLevels(chunk, false, baked.groundLevels);
+		if (chunk.overLayerVertices.getVertexCount() == 0)
+			baked.overLevels.clear();
+		else
+			baked.baked = baked.baked && bakeLevels(chunk, true, baked.overLevels);
+		baked.revision = chunk.revision;
+
+		if (!baked.baked)
+			return nullptr;
+	}
+
+	const std::vector<sf::Texture> &levels = overLayers ? baked.overLevels : baked.groundLevels;
+	return &levels[level - 1];
 }
 
-void WorldTerrain::render(sf::RenderTarget &target, sf::RenderStates &states, bool overLayers) const
+bool WorldTerrain::bakeLevels(const TerrainChunk &chunk, bool overLayers, std::vector<sf::Texture> &levels) const
 {
-	states.texture = tileset.getTexture();
-	target.draw(overLayers ? overLayerVertices : tileVertices, states);
+	// render targets shared by every chunk, at full resolution then each level's size, so each level is drawn from a
+	// different texture than it's drawn into, and is copied out whole
+	unsigned scratchSize = static_cast<unsigned>(chunkSize * Constants::tilesetResolution);
+	if (bakeTargets.empty())
+	{
+		for (int level = 0; level <= detailLevels; ++level)
+		{
+			unsigned targetSize = std::max(1u, scratchSize >> level);
+			std::unique_ptr<sf::RenderTexture> target(new sf::RenderTexture);
+			if (!target->create(targetSize, targetSize))
+			{
+				Logger::logWarning(format("Could not create %1%x%1% texture for baking terrain", _str(targetSize)));
+				bakeTargets.clear();
+				return false;
+			}
+
+			// halving with smoothing averages each 2x2 block of texels into one
+			target->setSmooth(true);
+			bakeTargets.push_back(std::move(target));
+		}
+	}
+
+	// full resolution first
+	sf::RenderTexture &scratch = *bakeTargets[0];
+	sf::Vector2u size(chunk.bounds.width * Constants::tilesetResolution,
+					  chunk.bounds.height * Constants::tilesetResolution);
+
+	sf::View view(sf::FloatRect(chunk.bounds.left, chunk.bounds.top, chunk.bounds.width, chunk.bounds.height));
+	view.setViewport(sf::FloatRect(0.f, 0.f, static_cast<float>(size.x) / scratchSize,
+								   static_cast<float>(size.y) / scratchSize));
+
+	scratch.setView(view);
+	scratch.clear(sf::Color::Transparent);
+
+	sf::RenderStates states(tileset.getTexture());
+	if (overLayers)
+		scratch.draw(chunk.overLayerVertices, states);
+	else
+	{
+		scratch.draw(chunk.tileVertices, states);
+		scratch.draw(chunk.objectVertices, states);
+	}
+	scratch.display();
+
+	// then halve each level into the next target, copying it out on the gpu
+	sf::IntRect previousRect(0, 0, size.x, size.y);
+	levels.resize(detailLevels);
+
+	for (int i = 0; i < detailLevels; ++i)
+	{
+		sf::RenderTexture &previous = *bakeTargets[i];
+		sf::RenderTexture &target = *bakeTargets[i + 1];
+		sf::IntRect levelRect(0, 0, std::max(1, previousRect.width / 2), std::max(1, previousRect.height / 2));
+
+		sf::Sprite sprite(previous.getTexture(), previousRect);
+		sprite.setScale(static_cast<float>(levelRect.width) / previousRect.width,
+						static_cast<float>(levelRect.height) / previousRect.height);
+
+		target.setView(target.getDefaultView());
+		target.clear(sf::Color::Transparent);
+		target.draw(sprite, sf::BlendNone);
+		target.display();
+
+		sf::Texture &level = levels[i];
+		if (level.getSize() != target.getSize() && !level.create(target.getSize().x, target.getSize().y))
+			return false;
+		level.update(target.getTexture());
+		level.setSmooth(true);
+
+		previousRect = levelRect;
+	}
+
+	return true;
 }
 
-void WorldTerrain::load(const TMX::TileMap *tileMap, const std::string &tilesetPath)
+void WorldTerrain::load(const CompiledWorld &compiled, const std::string &tilesetPath)
 {
 	// find layer count and depths
-	std::vector<TMX::Layer *> layers = tileMap->layers;
-	std::vector<LayerType> types;
-	discoverLayers(layers, types);
+	tileLayerCount = 0;
+	overLayerCount = 0;
+	for (const CompiledWorld::Layer &layer : compiled.getLayers())
+	{
+		LayerType layerType = static_cast<LayerType>(layer.type);
+		if (isTileLayer(layerType))
+			++tileLayerCount;
+		if (isOverLayer(layerType))
+			++overLayerCount;
+
+		registerLayer(layerType, layer.depth);
+	}
 
 	Logger::logDebug(format("Discovered %1% tile layer(s), of which %2% is/are overlayer(s)", _str(tileLayerCount),
 							_str(overLayerCount)));
 
-	// resize vertex array to accommodate for layer count
-	resizeVertices();
-
 	// update tileset with flipped textures
-	std::vector<int> flippedGIDs;
-	discoverFlippedTiles(layers, flippedGIDs);
-	tileset.load(tilesetPath);
-	tileset.convertToTexture(flippedGIDs);
+	std::vector<int> flippedGIDs(compiled.getFlippedGIDs().begin(), compiled.getFlippedGIDs().end());
+
+	// decode the tileset in the background while the vertex arrays are resized to accommodate for layer count
+	auto preparing = std::async(std::launch::async, &Tileset::prepare, &tileset, std::cref(tilesetPath),
+								std::cref(flippedGIDs), Config::getBool("world.tileset-cache", true));
+
+	resizeVertices();
+	preparing.get();
+	tileset.upload();
 
 	// add tiles to terrain
-	addTiles(layers, types);
+	addTiles(compiled);
+
+	std::size_t slotVertices = 0;
+	for (TerrainChunk &chunk : chunks)
+	{
+		cullHiddenTiles(chunk);
+		slotVertices += chunk.tileSlots.getVertexCount() + chunk.overLayerSlots.getVertexCount();
+	}
+
+	Logger::logDebug(format("Culled hidden and empty tiles, leaving %1% of %2% tile vertices",
+							_str(getTileVertexCount()), _str(slotVertices)));
 }
 
-RenderService::RenderService(sf::RenderWindow *renderWindow) : window(renderWindow)
+RenderService::RenderService(sf::RenderWindow *renderWindow) : window(renderWindow), target(renderWindow), open(true),
+															   drawCalls(0), submittedVertices(0)
+{
+}
+
+RenderService::RenderService(sf::RenderTexture &renderTexture) : window(nullptr), target(&renderTexture), open(true),
+																 drawCalls(0), submittedVertices(0)
 {
 }
 
@@ -466,17 +1081,36 @@ sf::RenderWindow *RenderService::getWindow()
 	return window;
 }
 
+sf::RenderTarget *RenderService::getTarget()
+{
+	return target;
+}
+
+void RenderService::close()
+{
+	open = false;
+	if (window != nullptr)
+		window->close();
+}
+
+bool RenderService::isOpen() const
+{
+	return open && (window == nullptr || window->isOpen());
+}
+
 void RenderService::render(const World &world)
 {
+	drawCalls = 0;
+	submittedVertices = 0;
 	limitView(world);
 
-	window->setView(*view);
-	window->draw(world);
+	target->setView(*view);
+	target->draw(world);
 }
 
 sf::Vector2f RenderService::mapScreenToWorld(const sf::Vector2i &screenPos)
 {
-	return window->mapPixelToCoords(screenPos, *view);
+	return target->mapPixelToCoords(screenPos, *view);
 }
 
 void RenderService::limitView(const World &world)
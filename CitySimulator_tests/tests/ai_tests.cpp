@@ -0,0 +1,170 @@
+#include "test_helpers.hpp"
+#include "avoidance.hpp"
+#include "behaviour.hpp"
+
+AvoidanceAgent createAgent(float x, float y, float velX, float velY)
+{
+	AvoidanceAgent agent;
+	agent.position.Set(x, y);
+	agent.velocity.Set(velX, velY);
+	agent.preferredVelocity = agent.velocity;
+	agent.radius = 0.5f;
+	agent.maxSpeed = 2.f;
+	agent.responsive = true;
+	return agent;
+}
+
+TEST(AvoidanceTests, NoNeighbours)
+{
+	AvoidanceAgent agent = createAgent(0.f, 0.f, 1.f, 0.f);
+	std::vector<const AvoidanceAgent *> neighbours;
+	Avoidance::Scratch scratch;
+
+	b2Vec2 velocity = Avoidance::computeVelocity(agent, neighbours, 2.f, 0.1f, scratch);
+	EXPECT_FLOAT_EQ(velocity.x, 1.f);
+	EXPECT_FLOAT_EQ(velocity.y, 0.f);
+}
+
+TEST(AvoidanceTests, HeadOn)
+{
+	AvoidanceAgent a = createAgent(0.f, 0.f, 1.f, 0.f);
+	AvoidanceAgent b = createAgent(3.f, 0.05f, -1.f, 0.f);
+	Avoidance::Scratch scratch;
+
+	std::vector<const AvoidanceAgent *> aNeighbours = {&b};
+	std::vector<const AvoidanceAgent *> bNeighbours = {&a};
+
+	b2Vec2 aVelocity = Avoidance::computeVelocity(a, aNeighbours, 2.f, 0.1f, scratch);
+	b2Vec2 bVelocity = Avoidance::computeVelocity(b, bNeighbours, 2.f, 0.1f, scratch);
+
+	// both sidestep in opposite directions, without exceeding their speed
+	EXPECT_LT(aVelocity.y, 0.f);
+	EXPECT_GT(bVelocity.y, 0.f);
+	EXPECT_LE(aVelocity.Length(), a.maxSpeed + 0.001f);
+	EXPECT_LE(bVelocity.Length(), b.maxSpeed + 0.001f);
+}
+
+TEST(AvoidanceTests, Stationary)
+{
+	AvoidanceAgent a = createAgent(0.f, 0.f, 1.f, 0.f);
+	AvoidanceAgent b = createAgent(2.f, 0.f, 0.f, 0.f);
+	b.responsive = false;
+	Avoidance::Scratch scratch;
+
+	std::vector<const AvoidanceAgent *> neighbours = {&b};
+	b2Vec2 velocity = Avoidance::computeVelocity(a, neighbours, 2.f, 0.1f, scratch);
+
+	// can't walk straight through
+	EXPECT_GT(fabsf(velocity.y), 0.f);
+}
+
+TEST(BehaviourTests, Loading)
+{
+	BehaviourTrees trees;
+	Behaviour::loadTrees(DATA_ROOT "/test_behaviours.json", trees);
+	ASSERT_EQ(trees.size(), 2u);
+
+	const BehaviourTree &tree = trees["test-sequence"];
+	ASSERT_EQ(tree.getNodeCount(), 3u);
+	EXPECT_EQ(tree.getNode(0).type, BEHAVIOUR_SEQUENCE);
+	EXPECT_EQ(tree.getNode(0).end, 3);
+	EXPECT_EQ(tree.getNode(1).type, BEHAVIOUR_WANDER);
+	EXPECT_FLOAT_EQ(tree.getNode(1).params[0], 2.f);
+	EXPECT_EQ(tree.getNode(2).type, BEHAVIOUR_WAIT);
+	EXPECT_FLOAT_EQ(tree.getNode(2).params[1], 2.f);
+
+	EXPECT_ERROR_MESSAGE(Behaviour::loadTrees("not a real file", trees);, "")
+}
+
+TEST(BehaviourTests, Sequence)
+{
+	BehaviourTrees trees;
+	Behaviour::loadTrees(DATA_ROOT "/test_behaviours.json", trees);
+	const BehaviourTree &tree = trees["test-sequence"];
+
+	Blackboard blackboard;
+	EXPECT_EQ(tree.think(blackboard), 1);
+	EXPECT_EQ(blackboard.status, STATUS_RUNNING);
+
+	// still running
+	EXPECT_EQ(tree.think(blackboard), 1);
+
+	blackboard.status = STATUS_SUCCESS;
+	EXPECT_EQ(tree.think(blackboard), 2);
+
+	// start again from the top
+	blackboard.status = STATUS_SUCCESS;
+	EXPECT_EQ(tree.think(blackboard), 1);
+
+	// failure aborts the sequence, which starts again
+	blackboard.status = STATUS_FAILURE;
+	EXPECT_EQ(tree.think(blackboard), 1);
+}
+
+TEST(BehaviourTests, LongSequence)
+{
+	boost::property_tree::ptree root, children, action;
+	root.put("type", "sequence");
+	action.put("type", "wait");
+	for (int i = 0; i < 3; ++i)
+		children.push_back({"", action});
+	root.add_child("children", children);
+
+	BehaviourTree tree;
+	tree.load(root);
+
+	// every action is reached in turn
+	Blackboard blackboard;
+	EXPECT_EQ(tree.think(blackboard), 1);
+
+	blackboard.status = STATUS_SUCCESS;
+	EXPECT_EQ(tree.think(blackboard), 2);
+
+	blackboard.status = STATUS_SUCCESS;
+	EXPECT_EQ(tree.think(blackboard), 3);
+
+	blackboard.status = STATUS_SUCCESS;
+	EXPECT_EQ(tree.think(blackboard), 1);
+}
+
+TEST(BehaviourTests, MaxDepth)
+{
+	// a wait inside as many sequences as a blackboard can resume
+	boost::property_tree::ptree node;
+	node.put("type", "wait");
+	for (unsigned i = 0; i < MAX_BEHAVIOUR_DEPTH; ++i)
+	{
+		boost::property_tree::ptree parent, children;
+		parent.put("type", "sequence");
+		children.push_back({"", node});
+		parent.add_child("children", children);
+		node = parent;
+	}
+
+	BehaviourTree tree;
+	ASSERT_NO_THROW(tree.load(node));
+
+	Blackboard blackboard;
+	EXPECT_EQ(tree.think(blackboard), MAX_BEHAVIOUR_DEPTH);
+
+	// one more is too deep
+	boost::property_tree::ptree parent, children;
+	parent.put("type", "sequence");
+	children.push_back({"", node});
+	parent.add_child("children", children);
+	EXPECT_THROW(tree.load(parent), std::runtime_error);
+}
+
+TEST(BehaviourTests, Selector)
+{
+	BehaviourTrees trees;
+	Behaviour::loadTrees(DATA_ROOT "/test_behaviours.json", trees);
+	const BehaviourTree &tree = trees["test-selector"];
+
+	// chance always fails
+	Blackboard blackboard;
+	EXPECT_EQ(tree.think(blackboard), 4);
+
+	blackboard.status = STATUS_SUCCESS;
+	EXPECT_EQ(tree.think(blackboard), 4);
+}
@@ -14,6 +14,7 @@ struct EntityTests : public ::testing::Test
 
 	virtual void TearDown() override
 	{
+		boost::filesystem::remove(Utils::joinPaths(Config::getResource("entities.root"), "sprites.cache"));
 	}
 };
 
@@ -52,3 +53,60 @@ TEST_F(EntityTests, Sprite)
 
 	EXPECT_NO_THROW(Animator(anim, 0.25f));
 }
+
+TEST(AnimationTests, FrameTable)
+{
+	Animation anim(nullptr);
+	anim.addRow({0, 0}, {16, 32}, 3)->addRow({0, 32}, {16, 32}, 3);
+
+	ASSERT_EQ(anim.frames.size(), 6u);
+	ASSERT_EQ(anim.sequences.size(), 2u);
+	EXPECT_EQ(anim.sequences[1].first, 3u);
+
+	const Animation::Frame &frame = anim.getFrame(1, 2);
+	EXPECT_EQ(frame.rect, sf::IntRect(32, 32, 16, 32));
+	EXPECT_EQ(frame.quad[2].position, sf::Vector2f(16, 32));
+	EXPECT_EQ(frame.quad[2].texCoords, sf::Vector2f(48, 64));
+}
+
+TEST(AnimationTests, ClockDriven)
+{
+	Animation anim(nullptr);
+	anim.addRow({0, 0}, {16, 32}, 4);
+
+	Animator animator(&anim, 0.25f, DIRECTION_SOUTH, true);
+	animator.evaluate(10.f);
+	EXPECT_EQ(animator.getCurrentFrame(), 0u);
+	animator.evaluate(10.3f);
+	EXPECT_EQ(animator.getCurrentFrame(), 1u);
+	animator.evaluate(10.8f);
+	EXPECT_EQ(animator.getCurrentFrame(), 3u);
+
+	// paused frames hold, and carry on from there
+	animator.setPlaying(false);
+	animator.evaluate(20.f);
+	EXPECT_EQ(animator.getCurrentFrame(), 3u);
+
+	animator.setPlaying(true);
+	animator.evaluate(30.f);
+	EXPECT_EQ(animator.getCurrentFrame(), 3u);
+	animator.evaluate(30.25f);
+	EXPECT_EQ(animator.getCurrentFrame(), 0u);
+}
+
+TEST_F(EntityTests, SpriteCache)
+{
+	// the fixture has already processed and cached the same sprites
+	Locator::provide(SERVICE_ANIMATION, new AnimationService);
+	Locator::provide(SERVICE_ENTITY, new EntityService);
+
+	AnimationService *as = Locator::locate<AnimationService>();
+	as->processQueuedSprites();
+	EXPECT_TRUE(as->isFromCache());
+
+	Animation *anim = nullptr;
+	ASSERT_NO_THROW(anim = as->getAnimation(ENTITY_HUMAN, "Test Man"));
+	ASSERT_EQ(anim->sequences.size(), 4u);
+	for (const Animation::Sequence &sequence : anim->sequences)
+		EXPECT_EQ(sequence.length, 4u);
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "test_helpers.hpp"
 #include "service/locator.hpp"
 
@@ -60,3 +61,73 @@ TEST(ServicesTest, InputKeyBindings)
 	EXPECT_EQ(input->getBinding(sf::Keyboard::G), KEY_UP);
 	EXPECT_EQ(input->getKey(KEY_UP), sf::Keyboard::G);
 }
+
+TEST(ServicesTest, ClockService)
+{
+	ClockService clock;
+	clock.setTimeScale(60.f * 60.f); // an hour per second
+	clock.setTime(0);
+
+	EXPECT_FLOAT_EQ(clock.getHourOfDay(), 0.f);
+	EXPECT_EQ(clock.getDay(), 0);
+
+	clock.tick(25.5f);
+	EXPECT_FLOAT_EQ(clock.getHourOfDay(), 1.5f);
+	EXPECT_EQ(clock.getDay(), 1);
+
+	// later today, then tomorrow
+	EXPECT_DOUBLE_EQ(clock.getNextTimeOfHour(2.f), 26 * 60 * 60);
+	EXPECT_DOUBLE_EQ(clock.getNextTimeOfHour(1.f), 49 * 60 * 60);
+
+	// wake in order
+	clock.scheduleWake(3, clock.getTime() + 2 * 60 * 60);
+	clock.scheduleWake(1, clock.getTime() + 1 * 60 * 60);
+	EXPECT_TRUE(clock.isSleeping(1));
+	EXPECT_TRUE(clock.isSleeping(3));
+	EXPECT_FALSE(clock.isSleeping(2));
+	EXPECT_EQ(clock.getSleepingCount(), 2u);
+
+	clock.tick(1.5f);
+	EXPECT_FALSE(clock.isSleeping(1));
+	EXPECT_TRUE(clock.isSleeping(3));
+
+	// rescheduling replaces the old wake up
+	clock.scheduleWake(3, clock.getTime() + 5 * 60 * 60);
+	clock.tick(1.f);
+	EXPECT_TRUE(clock.isSleeping(3));
+	EXPECT_EQ(clock.getSleepingCount(), 1u);
+
+	clock.cancelWake(3);
+	EXPECT_FALSE(clock.isSleeping(3));
+	EXPECT_EQ(clock.getSleepingCount(), 0u);
+}
+
+TEST(ServicesTest, ClockAwakeEntities)
+{
+	ClockService clock;
+	clock.setTimeScale(60.f * 60.f);
+	clock.setTime(0);
+
+	clock.addEntity(1);
+	clock.addEntity(2);
+	clock.addEntity(4);
+	EXPECT_EQ(clock.getAwakeEntities().size(), 3u);
+
+	// sleepers aren't visited until woken
+	clock.scheduleWake(2, clock.getTime() + 60 * 60);
+	std::vector<EntityID> awake(clock.getAwakeEntities());
+	std::sort(awake.begin(), awake.end());
+	EXPECT_EQ(awake, std::vector<EntityID>({1, 4}));
+
+	clock.tick(1.5f);
+	EXPECT_EQ(clock.getAwakeEntities().size(), 3u);
+
+	// removed entities stay out, even when their wake up is due
+	clock.scheduleWake(4, clock.getTime() + 60 * 60);
+	clock.removeEntity(4);
+	clock.tick(1.5f);
+	awake = clock.getAwakeEntities();
+	std::sort(awake.begin(), awake.end());
+	EXPECT_EQ(awake, std::vector<EntityID>({1, 2}));
+	EXPECT_EQ(clock.getSleepingCount(), 0u);
+}
@@ -1,5 +1,10 @@
 #include <boost/filesystem.hpp>
 #include "utils.hpp"
+#include "atlas_packer.hpp"
+#include "serialization.hpp"
+#include "spatial.hpp"
+#include "sprite_batch.hpp"
+#include "workers.hpp"
 #include "test_helpers.hpp"
 
 TEST(UtilTests, Format)
@@ -76,4 +81,121 @@ TEST(UtilTests, FileSearching)
 	EXPECT_ANY_THROW(Utils::searchForFile("", dir));
 
 	EXPECT_ANY_THROW(Utils::searchForFile("robert", ""));
-}
\ No newline at end of file
+}
+
+TEST(UtilTests, Hash)
+{
+	EXPECT_EQ(Serialization::hash("", 0), Serialization::hashSeed);
+	EXPECT_EQ(Serialization::hash("a", 1), 0xaf63dc4c8601ec8cULL);
+
+	// continuing a hash is the same as hashing everything at once
+	EXPECT_EQ(Serialization::hash("bar", 3, Serialization::hash("foo", 3)), Serialization::hash("foobar", 6));
+}
+
+TEST(UtilTests, AtlasPacker)
+{
+	// rounded down to 64
+	AtlasPacker packer(100);
+
+	std::vector<sf::Vector2u> sizes(4, sf::Vector2u(32, 32));
+	ASSERT_TRUE(packer.pack(sizes));
+	ASSERT_EQ(packer.getPageSizes().size(), 1u);
+	EXPECT_EQ(packer.getPageSizes()[0], sf::Vector2u(64, 64));
+	EXPECT_FLOAT_EQ(packer.getEfficiency(), 1.f);
+
+	// spills onto a smaller second page
+	sizes.assign(5, sf::Vector2u(64, 64));
+	AtlasPacker pages(128);
+	ASSERT_TRUE(pages.pack(sizes));
+	ASSERT_EQ(pages.getPageSizes().size(), 2u);
+	EXPECT_EQ(pages.getPageSizes()[1], sf::Vector2u(64, 64));
+
+	const std::vector<AtlasPacker::Placement> &placements = pages.getPlacements();
+	ASSERT_EQ(placements.size(), sizes.size());
+	for (size_t i = 0; i < placements.size(); ++i)
+	{
+		for (size_t j = i + 1; j < placements.size(); ++j)
+			EXPECT_FALSE(placements[i].page == placements[j].page && placements[i].rect.intersects(placements[j].rect));
+	}
+
+	// too big
+	sizes.assign(1, sf::Vector2u(200, 8));
+	EXPECT_FALSE(pages.pack(sizes));
+}
+
+TEST(UtilTests, SpatialGrid)
+{
+	SpatialGrid grid(2.f, 16);
+	grid.insert(0, sf::Vector2f(1.f, 1.f));
+	grid.insert(1, sf::Vector2f(3.f, 1.f));
+	grid.insert(2, sf::Vector2f(-5.f, 20.f));
+	grid.insert(3, sf::Vector2f(100.f, 100.f));
+	grid.rebuild();
+	EXPECT_EQ(grid.getEntityCount(), 4u);
+
+	std::vector<EntityID> found;
+	grid.query(sf::FloatRect(0.f, 0.f, 4.f, 4.f), found);
+	std::sort(found.begin(), found.end());
+	EXPECT_EQ(found, std::vector<EntityID>({0, 1}));
+
+	found.clear();
+	grid.query(sf::FloatRect(-6.f, 19.f, 2.f, 2.f), found);
+	EXPECT_EQ(found, std::vector<EntityID>({2}));
+
+	// larger than the number of buckets
+	found.clear();
+	grid.query(sf::FloatRect(-1000.f, -1000.f, 2000.f, 2000.f), found);
+	EXPECT_EQ(found.size(), 4u);
+
+	grid.clear();
+	found.clear();
+	grid.query(sf::FloatRect(0.f, 0.f, 4.f, 4.f), found);
+	EXPECT_TRUE(found.empty());
+}
+
+TEST(UtilTests, WorkerPool)
+{
+	WorkerPool workers(3);
+
+	std::vector<int> values(1000, 0);
+	workers.parallelFor(values.size(), [&values](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			values[i] += i;
+	});
+
+	for (size_t i = 0; i < values.size(); ++i)
+		ASSERT_EQ(values[i], i);
+
+	EXPECT_ERROR_MESSAGE(workers.parallelFor(values.size(), [](size_t begin, size_t end)
+	{
+		if (begin != 0)
+			error("Bad range");
+	});, "Bad range")
+}
+
+TEST(UtilTests, SpriteBatchDepthSort)
+{
+	SpriteBatch batch(8, true);
+	batch.begin();
+
+	// bottom edges at 30, 10, 20, 10
+	const float tops[] = {20.f, 0.f, 10.f, 0.f};
+	for (float top : tops)
+	{
+		sf::Vertex quad[4];
+		quad[0].position = sf::Vector2f(0.f, top);
+		quad[1].position = sf::Vector2f(10.f, top);
+		quad[2].position = sf::Vector2f(10.f, top + 10.f);
+		quad[3].position = sf::Vector2f(0.f, top + 10.f);
+
+		batch.add(quad, sf::RenderStates::Default);
+	}
+
+	batch.sort();
+
+	// ties stay in the order they were added
+	std::vector<unsigned> expected = {1, 3, 2, 0};
+	EXPECT_EQ(batch.getOrder(), expected);
+	EXPECT_EQ(batch.getSpriteCount(), 4u);
+}
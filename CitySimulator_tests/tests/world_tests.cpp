@@ -1,5 +1,9 @@
+#include <fstream>
 #include "test_helpers.hpp"
 #include "world.hpp"
+#include "portal_graph.hpp"
+#include "maploader.hpp"
+#include "compiled_world.hpp"
 
 class WorldTest : public ::testing::Test
 {
@@ -18,6 +22,15 @@ protected:
 
 	virtual void TearDown() override
 	{
+		boost::filesystem::remove(world->getFilePath() + ".doors");
+
+		// every world's tileset cache
+		for (boost::filesystem::directory_iterator it(DATA_ROOT), end; it != end; ++it)
+		{
+			std::string name(it->path().filename().string());
+			if (name.find("test_tileset.png.") == 0 && name.find(".cache") == name.size() - 6)
+				boost::filesystem::remove(it->path());
+		}
 	}
 };
 
@@ -26,4 +39,299 @@ TEST_F(WorldTest, Size)
 	auto realSize = sf::Vector2i(6, 6);
 	EXPECT_EQ(world->getTileSize(), realSize);
 	EXPECT_EQ(world->getPixelSize(), Utils::toPixel(realSize));
-}
\ No newline at end of file
+}
+
+TEST_F(WorldTest, QueuedBlockChanges)
+{
+	WorldTerrain &terrain = world->getTerrain();
+	terrain.applyChanges();
+
+	sf::Vector2i tile(1, 1);
+	terrain.setBlockType(tile, BLOCK_ROAD, LAYER_TERRAIN);
+	terrain.setBlockType(tile, BLOCK_SAND, LAYER_TERRAIN);
+	terrain.setBlockType({2, 3}, BLOCK_WATER, LAYER_TERRAIN);
+
+	// block types change immediately, but vertices wait
+	EXPECT_EQ(world->getBlockAt(tile, LAYER_TERRAIN), BLOCK_SAND);
+	EXPECT_EQ(terrain.getPendingChangeCount(), 2u);
+
+	// the test world fits in a single chunk
+	EXPECT_EQ(terrain.applyChanges(), 1);
+	EXPECT_EQ(terrain.getPendingChangeCount(), 0u);
+	EXPECT_EQ(terrain.applyChanges(), 0);
+}
+
+TEST_F(WorldTest, HiddenTilesCulled)
+{
+	WorldTerrain &terrain = world->getTerrain();
+
+	// 38 visible tiles and 6 overterrain tiles, as 1 underterrain tile is under an opaque tile and the rest is blank
+	EXPECT_EQ(terrain.getTileVertexCount(), 44u * 4);
+
+	// covering another underterrain tile
+	terrain.setBlockType({2, 2}, BLOCK_ROAD, LAYER_TERRAIN);
+	terrain.applyChanges();
+	EXPECT_EQ(terrain.getTileVertexCount(), 43u * 4);
+}
+
+TEST_F(WorldTest, DetailLevel)
+{
+	WorldTerrain &terrain = world->getTerrain();
+
+	// full detail when tiles are big enough
+	EXPECT_EQ(terrain.getDetailLevel(Constants::tilesetResolution), 0);
+	EXPECT_EQ(terrain.getDetailLevel(8.f), 0);
+
+	// the smallest level that still has a texel per pixel
+	EXPECT_EQ(terrain.getDetailLevel(7.f), 1);
+	EXPECT_EQ(terrain.getDetailLevel(4.f), 2);
+	EXPECT_EQ(terrain.getDetailLevel(3.f), 2);
+	EXPECT_EQ(terrain.getDetailLevel(0.01f), 4);
+}
+
+TEST_F(WorldTest, TilesetCache)
+{
+	// enough horizontally flipped tiles to need another row in the tileset
+	std::vector<int> flippedGIDs;
+	for (int blockType = BLOCK_GRASS; blockType <= BLOCK_FENCE; ++blockType)
+		flippedGIDs.push_back(static_cast<int>(0x80000000 | blockType));
+
+	// left over from an older image
+	const std::string stale("data/test_tileset.png.0000000000000000.0000000000000000.cache");
+	std::ofstream(stale.c_str()) << "stale";
+
+	Tileset converted;
+	converted.loadConverted("data/test_tileset.png", flippedGIDs);
+	EXPECT_FALSE(boost::filesystem::exists(stale));
+
+	Tileset cached;
+	cached.loadConverted("data/test_tileset.png", flippedGIDs);
+	EXPECT_TRUE(cached.isFromCache());
+	EXPECT_EQ(cached.getSize(), converted.getSize());
+	EXPECT_EQ(cached.getTexture()->getSize(), converted.getTexture()->getSize());
+
+	// different flips miss the cache
+	Tileset other;
+	other.loadConverted("data/test_tileset.png", {});
+	EXPECT_NE(other.getSize(), converted.getSize());
+	EXPECT_FALSE(other.isFromCache());
+
+	// without replacing the first
+	Tileset cachedAgain;
+	cachedAgain.loadConverted("data/test_tileset.png", flippedGIDs);
+	EXPECT_TRUE(cachedAgain.isFromCache());
+
+	Tileset otherCached;
+	otherCached.loadConverted("data/test_tileset.png", {});
+	EXPECT_TRUE(otherCached.isFromCache());
+}
+
+TEST(MapLoaderTest, ParseTMX)
+{
+	std::unique_ptr<TMX::TileMap> tmx(TMX::TileMap::load(Utils::joinPaths(DATA_ROOT, "test_world.tmx")));
+	ASSERT_EQ(tmx->width, 6);
+	ASSERT_EQ(tmx->height, 6);
+	ASSERT_EQ(tmx->layers.size(), 4u);
+
+	TMX::Layer *overterrain = tmx->layers[2];
+	EXPECT_EQ(overterrain->name, "overterrain");
+	ASSERT_EQ(overterrain->gids.size(), 36u);
+	EXPECT_EQ(overterrain->gids[2], 17u);
+	EXPECT_EQ(overterrain->gids[4], 2147483665u);
+
+	// flip flags are decoded on demand
+	EXPECT_FALSE(overterrain->getTile(2).isFlipped());
+	EXPECT_EQ(overterrain->getTile(4).getGID(), 16u);
+	EXPECT_TRUE(overterrain->getTile(4).isFlipped());
+
+	TMX::Layer *objects = tmx->layers[3];
+	EXPECT_TRUE(objects->gids.empty());
+	EXPECT_TRUE(objects->shapes.empty());
+	ASSERT_EQ(objects->objects.size(), 3u);
+	EXPECT_EQ(objects->objects[0].getTile().getGID(), 8u);
+	EXPECT_FLOAT_EQ(objects->objects[0].rotationAnglef, -20.f);
+
+	EXPECT_THROW(TMX::TileMap::load("missing.tmx"), std::runtime_error);
+}
+
+TEST(MapLoaderTest, ParseBase64)
+{
+	// the same map, with a plain, a zlib and a gzip layer
+	std::unique_ptr<TMX::TileMap> csv(TMX::TileMap::load(Utils::joinPaths(DATA_ROOT, "test_world.tmx")));
+	std::unique_ptr<TMX::TileMap> base64(TMX::TileMap::load(Utils::joinPaths(DATA_ROOT, "test_world_base64.tmx")));
+
+	ASSERT_EQ(base64->layers.size(), csv->layers.size());
+	for (size_t i = 0; i < csv->layers.size(); ++i)
+		EXPECT_EQ(base64->layers[i]->gids, csv->layers[i]->gids) << "in layer " << csv->layers[i]->name;
+}
+
+TEST(CompiledWorldTest, SaveAndOpen)
+{
+	std::unique_ptr<TMX::TileMap> tmx(TMX::TileMap::load(Utils::joinPaths(DATA_ROOT, "test_world.tmx")));
+
+	CompiledWorld compiled;
+	compiled.compile(*tmx);
+	EXPECT_FALSE(compiled.isMapped());
+	EXPECT_EQ(compiled.getTileSize(), sf::Vector2i(6, 6));
+	EXPECT_EQ(compiled.getTiles().size(), 3u * 6 * 6);
+	EXPECT_EQ(compiled.getObjects().size(), 3u);
+	ASSERT_TRUE(compiled.save("test_world.csw"));
+
+	{
+		CompiledWorld mapped;
+		ASSERT_TRUE(mapped.open("test_world.csw"));
+		EXPECT_TRUE(mapped.isMapped());
+		EXPECT_EQ(mapped.getTileSize(), compiled.getTileSize());
+		EXPECT_EQ(mapped.getLayers().size(), compiled.getLayers().size());
+		EXPECT_EQ(mapped.getCollisionRects().size(), compiled.getCollisionRects().size());
+		EXPECT_TRUE(std::equal(mapped.getTiles().begin(), mapped.getTiles().end(), compiled.getTiles().begin()));
+	}
+
+	// truncated
+	boost::filesystem::resize_file("test_world.csw", 16);
+	CompiledWorld truncated;
+	EXPECT_FALSE(truncated.open("test_world.csw"));
+	EXPECT_FALSE(truncated.open("missing.csw"));
+
+	boost::filesystem::remove("test_world.csw");
+}
+
+TEST(NavigationMeshTest, PathAroundWall)
+{
+	const sf::Vector2i size(10, 10);
+
+	// wall down the middle with a gap at the bottom
+	std::vector<bool> blocked(size.x * size.y, false);
+	for (int y = 0; y < 8; ++y)
+		blocked[y * size.x + 5] = true;
+
+	NavigationMesh nav(nullptr);
+	nav.generate(size, blocked);
+	EXPECT_EQ(nav.getPolygonCount(), 3u);
+
+	EXPECT_EQ(nav.findPolygon({5.5f, 2.5f}), -1);
+	EXPECT_EQ(nav.findPolygon({-1.f, 2.5f}), -1);
+	EXPECT_NE(nav.findPolygon({2.5f, 2.5f}), -1);
+
+	std::vector<sf::Vector2f> path;
+	ASSERT_TRUE(nav.findPath({2.5f, 2.5f}, {8.5f, 2.5f}, path));
+	ASSERT_EQ(path.size(), 4u);
+	EXPECT_EQ(path.front(), sf::Vector2f(2.5f, 2.5f));
+	EXPECT_EQ(path.back(), sf::Vector2f(8.5f, 2.5f));
+
+	// hugs the corners of the wall
+	for (size_t i = 1; i < path.size() - 1; ++i)
+		EXPECT_GT(path[i].y, 8.f);
+
+	// straight line
+	ASSERT_TRUE(nav.findPath({2.5f, 9.5f}, {8.5f, 9.5f}, path));
+	EXPECT_EQ(path.size(), 2u);
+
+	// blocked
+	EXPECT_FALSE(nav.findPath({2.5f, 2.5f}, {5.5f, 2.5f}, path));
+}
+
+TEST(NavigationMeshTest, Cache)
+{
+	const sf::Vector2i size(6, 4);
+	std::vector<bool> blocked(size.x * size.y, false);
+	blocked[8] = blocked[9] = true;
+
+	NavigationMesh nav(nullptr);
+	nav.generate(size, blocked);
+	ASSERT_TRUE(nav.save("test_navigation.nav"));
+
+	NavigationMesh loaded(nullptr);
+	EXPECT_FALSE(loaded.loadCache("test_navigation.nav", {5, 5}));
+	ASSERT_TRUE(loaded.loadCache("test_navigation.nav", size));
+	EXPECT_EQ(loaded.getPolygonCount(), nav.getPolygonCount());
+	EXPECT_EQ(loaded.getPortalCount(), nav.getPortalCount());
+
+	std::vector<sf::Vector2f> path, loadedPath;
+	EXPECT_TRUE(nav.findPath({0.5f, 0.5f}, {5.5f, 3.5f}, path));
+	EXPECT_TRUE(loaded.findPath({0.5f, 0.5f}, {5.5f, 3.5f}, loadedPath));
+	EXPECT_EQ(path, loadedPath);
+
+	// point the last portal, a neighbour index followed by two points, outside of the mesh
+	{
+		std::fstream file("test_navigation.nav", std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(-static_cast<std::streamoff>(sizeof(int) + sizeof(sf::Vector2f) * 2), std::ios::end);
+		int neighbour = 1000;
+		file.write(reinterpret_cast<const char *>(&neighbour), sizeof(int));
+	}
+
+	NavigationMesh corrupt(nullptr);
+	EXPECT_FALSE(corrupt.loadCache("test_navigation.nav", size));
+	EXPECT_EQ(corrupt.getPolygonCount(), 0u);
+
+	boost::filesystem::remove("test_navigation.nav");
+}
+
+TEST(PortalGraphTest, SameWorld)
+{
+	const sf::Vector2i size(4, 4);
+	std::vector<bool> blocked(size.x * size.y, false);
+	for (int y = 0; y < size.y; ++y)
+		blocked[y * size.x + 2] = true;
+
+	World world;
+	world.getNavigationMesh().generate(size, blocked);
+
+	PortalGraph graph;
+	graph.build({&world});
+	EXPECT_EQ(graph.getNodeCount(), 0u);
+
+	std::vector<RouteLeg> route;
+	ASSERT_TRUE(graph.findRoute(&world, {0.5f, 0.5f}, &world, {1.5f, 3.5f}, route));
+	ASSERT_EQ(route.size(), 1u);
+	EXPECT_EQ(route[0].world, &world);
+	EXPECT_EQ(route[0].end, sf::Vector2f(1.5f, 3.5f));
+
+	// cut off by the wall, with no doors around it
+	EXPECT_FALSE(graph.findRoute(&world, {0.5f, 0.5f}, &world, {3.5f, 0.5f}, route));
+}
+
+TEST(PortalGraphTest, ThroughBuilding)
+{
+	// the outside is split by a wall, which can only be crossed through the building
+	const sf::Vector2i outsideSize(6, 4);
+	std::vector<bool> blocked(outsideSize.x * outsideSize.y, false);
+	for (int y = 0; y < outsideSize.y; ++y)
+		blocked[y * outsideSize.x + 3] = true;
+
+	World outside, inside;
+	outside.getNavigationMesh().generate(outsideSize, blocked);
+	inside.getNavigationMesh().generate({3, 3}, std::vector<bool>(9, false));
+
+	Building &building = outside.getBuildingMap().addBuilding(1, sf::IntRect(1, 0, 4, 2), "inside");
+	building.setInsideWorld(&inside);
+	building.addDoor(1, {1, 1}, &outside);
+	building.addDoor(1, {0, 1}, &inside);
+	building.addDoor(2, {4, 1}, &outside);
+	building.addDoor(2, {2, 1}, &inside);
+
+	PortalGraph graph;
+	graph.build({&outside, &inside});
+	EXPECT_EQ(graph.getNodeCount(), 4u);
+
+	std::vector<RouteLeg> route;
+	ASSERT_TRUE(graph.findRoute(&outside, {0.5f, 0.5f}, &outside, {5.5f, 3.5f}, route));
+	ASSERT_EQ(route.size(), 3u);
+
+	EXPECT_EQ(route[0].world, &outside);
+	EXPECT_EQ(route[0].end, sf::Vector2f(1.5f, 1.5f));
+
+	EXPECT_EQ(route[1].world, &inside);
+	EXPECT_EQ(route[1].start, sf::Vector2f(0.5f, 1.5f));
+	EXPECT_EQ(route[1].end, sf::Vector2f(2.5f, 1.5f));
+
+	EXPECT_EQ(route[2].world, &outside);
+	EXPECT_EQ(route[2].start, sf::Vector2f(4.5f, 1.5f));
+	EXPECT_EQ(route[2].end, sf::Vector2f(5.5f, 3.5f));
+
+	// into the building
+	ASSERT_TRUE(graph.findRoute(&outside, {5.5f, 3.5f}, &inside, {1.5f, 1.5f}, route));
+	ASSERT_EQ(route.size(), 2u);
+	EXPECT_EQ(route[1].world, &inside);
+	EXPECT_EQ(route[1].start, sf::Vector2f(2.5f, 1.5f));
+}
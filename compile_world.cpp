@@ -0,0 +1,45 @@
+#include <iostream>
+#include <memory>
+#include "compiled_world.hpp"
+#include "world.hpp"
+#include "service/locator.hpp"
+
+/**
+ * Compiles each given map to the binary world format, next to the map
+ */
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <map.tmx>..." << std::endl;
+		return -1;
+	}
+
+	Locator::provide(SERVICE_LOGGING, new LoggingService(std::cout, LOG_DEBUG));
+
+	int failures = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string path(argv[i]);
+		std::string compiledPath(World::getCompiledPath(path));
+
+		try
+		{
+			std::unique_ptr<TMX::TileMap> tmx(TMX::TileMap::load(path));
+
+			CompiledWorld compiled;
+			compiled.compile(*tmx);
+
+			if (!compiled.save(compiledPath))
+				error("Could not write '%1%'", compiledPath);
+
+			Logger::logInfo(format("Compiled %1% to %2%", path, compiledPath));
+		} catch (std::exception &e)
+		{
+			Logger::logError(e.what());
+			++failures;
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
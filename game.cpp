@@ -1,9 +1,12 @@
 #include <boost/filesystem.hpp>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include "game.hpp"
 #include "service/locator.hpp"
 
 const std::string RESOURCE_DIR("res"); // todo probably shouldn't be hardcoded
+const char *HEADLESS_FLAG = "--headless";
 
 bool ensureCWD(int argc, char **argv)
 {
@@ -12,7 +15,8 @@ bool ensureCWD(int argc, char **argv)
 		// no args given
 		if (argc != 2)
 		{
-			std::cerr << "Root directory not found. \nUsage: " << argv[0] << " <relative path to root dir>" << std::endl;
+			std::cerr << "Root directory not found. \nUsage: " << argv[0] << " [" << HEADLESS_FLAG
+					  << "] <relative path to root dir>" << std::endl;
 			return false;
 		}
 
@@ -35,6 +39,18 @@ bool ensureCWD(int argc, char **argv)
 	return true;
 }
 
+/**
+ * Fails with instructions if there's no display for an OpenGL context, which SFML needs even to render offscreen
+ */
+void ensureDisplay(const char *program)
+{
+#if defined(__linux__) || defined(__FreeBSD__)
+	const char *display = getenv("DISPLAY");
+	if (display == nullptr || *display == '\0')
+		error("Headless mode still needs an X display for OpenGL, so run it under a virtual one, eg. "
+			  "'xvfb-run -a %1% %2%'", program, HEADLESS_FLAG);
+#endif
+}
 
 void loadConfig(int &windowStyle)
 {
@@ -71,8 +87,19 @@ int main(int argc, char **argv)
 {
 	try
 	{
+		// pull out flags, leaving the root directory
+		bool headless = false;
+		std::vector<char *> args;
+		for (int i = 0; i < argc; ++i)
+		{
+			if (strcmp(argv[i], HEADLESS_FLAG) == 0)
+				headless = true;
+			else
+				args.push_back(argv[i]);
+		}
+
 		// ensure that the program root is in the project root
-		if (!ensureCWD(argc, argv))
+		if (!ensureCWD(static_cast<int>(args.size()), args.data()))
 			return -1;
 
 		// create essential services
@@ -83,12 +110,29 @@ int main(int argc, char **argv)
 		int style;
 		loadConfig(style);
 
-		sf::RenderWindow window(sf::VideoMode(Constants::windowSize.x, Constants::windowSize.y), "Game", style);
+		// offscreen, for machines without a display
+		if (headless || Config::getBool("display.headless.enabled", false))
+		{
+			ensureDisplay(argv[0]);
 
-		// create game
-		Game game(window);
-		game.beginGame();
-		game.endGame();
+			sf::RenderTexture texture;
+			if (!texture.create(Constants::windowSize.x, Constants::windowSize.y))
+				error("Could not create %1%x%2% offscreen render texture", _str(Constants::windowSize.x),
+					  _str(Constants::windowSize.y));
+
+			Game game(texture);
+			game.beginGame();
+			game.endGame();
+		}
+		else
+		{
+			sf::RenderWindow window(sf::VideoMode(Constants::windowSize.x, Constants::windowSize.y), "Game", style);
+
+			// create game
+			Game game(window);
+			game.beginGame();
+			game.endGame();
+		}
 
 		Logger::logInfo("Shutdown cleanly");
 		return 0;